@@ -30,6 +30,29 @@
 // Common WAIT value in milliseconds between commands
 #define TEMPO 0
 
+// Transmit queue sizes (powers of two): bytes waiting to be sent, commands
+// waiting for their answer, and bytes of answers to synchronous reads
+#ifndef LCD_TX_QUEUE
+#define LCD_TX_QUEUE 1024
+#endif
+#define LCD_CMD_QUEUE 64
+#define LCD_RX_QUEUE  16
+
+// Commands that may be left unanswered while the next one is sent
+#ifndef LCD_OUTSTANDING
+#define LCD_OUTSTANDING 1
+#endif
+
+// Pacing: bytes the screen takes in while still busy with a command, the
+// gap that means "wait for the ACK", and the number of paced opcodes
+#define LCD_RX_BUFFER 16
+#define LCD_PACE_ACK  0xFFFF
+#define LCD_PACED     13
+
+// Microseconds a command's answer may take before the screen is taken to
+// have lost part of the command or its answer
+#define LCD_ANSWER_TIMEOUT 200000
+
 // 4DGL SGE Function values for Goldelox Processor
 #define CLS          '\xD7'
 #define BAUDRATE     '\x0B' //null prefix
@@ -55,6 +78,7 @@
 #define TEXTITALIC   '\x75'
 #define TEXTINVERSE  '\x74'
 #define TEXTUNDERLINE '\x73'
+#define TEXTCOLOR    '\x7F'
 #define TEXTWIDTH    '\x7C'
 #define TEXTHEIGHT   '\x7B'
 #define TEXTCHAR     '\xFE'
@@ -258,6 +282,11 @@ public :
     int  read_pixel(int, int);
     void pen_size(char);
     void BLIT(int x, int y, int w, int h, int *colors);
+    /** Draw a block of pixels already packed as the screen's big-endian RGB565
+    * byte stream (two bytes per pixel), so they are sent without conversion
+    * @param pixels w*h*2 bytes, row by row
+    */
+    void BLIT565(int x, int y, int w, int h, const unsigned char *pixels);
 
 // Text Commands
     void set_font(char);
@@ -276,6 +305,37 @@ public :
     void putc(char);
     void puts(char *);
 
+// Transmit queue
+    /** Commands return as soon as they are queued; the UART interrupts send
+    * them and collect the screen's answers in the background. Wait until
+    * everything queued has been sent and answered
+    * @return number of commands since the last flush the screen did not ACK
+    */
+    int  flush();
+    /** Bytes queued but not yet handed to the UART */
+    int  queue_depth();
+    /** Commands queued or sent whose answer has not arrived */
+    int  pending_commands();
+
+// Pacing
+    /** How soon the next command may follow one with this opcode, in
+    * microseconds after its last byte (LCD_PACE_ACK: only once it is
+    * answered), and for blits how soon the pixels may follow the header.
+    * An ACK always releases the next command early
+    */
+    struct Pacing {
+        char opcode;
+        unsigned short gap_us;
+        unsigned short setup_us;
+    };
+    Pacing pacing[LCD_PACED];
+    /** Measure the screen's service time for each paced opcode and the
+    * shortest blit setup that still draws correctly, and set the pacing
+    * table from them. Call after baudrate(); draws on the screen, then
+    * clears it
+    */
+    void calibrate_pacing();
+
 //Media Commands
     int media_init();
     void set_byte_address(int, int);
@@ -308,11 +368,57 @@ public :
     int current_fx, current_fy;
     int current_wf, current_hf;
 
+// Link statistics
+    /** Total bytes sent to the screen over the serial link */
+    unsigned int tx_bytes;
+    /** Blits queued, microseconds spent inside BLIT and BLIT565, and the
+    * longest single blit */
+    unsigned int blit_count;
+    unsigned int blit_us;
+    unsigned int blit_max_us;
+    /** Microseconds spent blocked on the screen: queue full, or flushing */
+    unsigned int tx_wait_us;
+    /** Most bytes ever waiting in the transmit queue */
+    unsigned int tx_high_water;
+
 
 protected :
 
     Serial     _cmd;
     DigitalOut _rst;
+    Timer      _lcd_timer;
+    Timeout    _pace;           // resumes sending when a pacing gap is over
+    int        blit_start;      // _lcd_timer time the current blit started
+    int        current_baud;
+
+    // Ring buffers shared with the UART interrupts. Indices run freely and
+    // are masked on access; the foreground owns the heads, the interrupts
+    // own the tails. Commands between cmd_done and cmd_tail have been sent
+    // and are waiting for their answer.
+    char                  tx_ring[LCD_TX_QUEUE];
+    volatile unsigned int tx_head, tx_tail;
+    unsigned int          cmd_end[LCD_CMD_QUEUE];   // tx_head at the end of each command
+    unsigned int          cmd_setup[LCD_CMD_QUEUE]; // tx_head where a blit's pixels start
+    signed char           cmd_pace[LCD_CMD_QUEUE];  // pacing entry, -1 if unpaced
+    int                   cmd_sent[LCD_CMD_QUEUE];  // _lcd_timer time the last byte went out
+    char                  cmd_reply[LCD_CMD_QUEUE]; // bytes in the answer
+    volatile unsigned int cmd_head, cmd_tail, cmd_done;
+    volatile int          cmd_open;                 // slot cmd_head is being queued
+    volatile int          reply_left;               // bytes of the current answer still to come
+    volatile int          tx_errors;                // answers that were not ACK, or never came
+    volatile int          tx_partial;               // a command is partly sent
+    volatile int          feeding;                  // zeros go out until the oldest command is answered
+    int                   fed_us;                   // _lcd_timer time the last zero went out
+    int                   fed_count;                // zeros fed for the oldest command
+    char                  rx_ring[LCD_RX_QUEUE];    // bytes nobody was waiting an ACK for
+    volatile unsigned int rx_head, rx_tail;
+
+    // The byte at tx index hold_at waits until hold_until, if the hold is
+    // timed, or until every command is answered, if an ACK releases it
+    volatile unsigned int hold_at;
+    volatile int          hold_until;
+    volatile int          hold_active, hold_timed, hold_ack;
+    volatile int          sent_us, answered_us;     // last command out, last answer in
     //used by printf
     virtual int _putc(int c) {
         putc(c);
@@ -325,10 +431,29 @@ protected :
     void freeBUFFER  (void);
     void writeBYTE   (char);
     void writeBYTEfast   (char);
+    void beginCOMMAND(char, int);
+    void endCOMMAND  (void);
+    void commandSent (void);
+    void commandAnswered(void);
+    void checkAnswer (void);
+    void holdTX      (int, int);
+    int  pacingIndex (char);
+    int  paceGap     (int);
+    int  blitWorks   (void);
+    void drainTX     (void);
+    void kickTX      (void);
+    void pumpTX      (void);
+    void txIRQ       (void);
+    void rxIRQ       (void);
+    int  rxReadable  (void);
+    char rxGetc      (void);
     int  writeCOMMAND(char *, int);
     int  writeCOMMANDnull(char *, int);
+    void startBLIT   (int, int, int, int);
+    void finishBLIT  (void);
     int  readVERSION (char *, int);
     int  getSTATUS   (char *, int);
+    int  readWORD    (char *, int);
     int  version     (void);
 #if DEBUGMODE
     Serial pc;
@@ -223,17 +223,7 @@ void uLCD_4DGL :: pixel(int x, int y, int color)     // draw a pixel
 void uLCD_4DGL :: BLIT(int x, int y, int w, int h, int *colors)     // draw a block of pixels
 {
     int red5, green6, blue5;
-    writeBYTEfast('\x00');
-    writeBYTEfast(BLITCOM);
-    writeBYTEfast((x >> 8) & 0xFF);
-    writeBYTEfast(x & 0xFF);
-    writeBYTEfast((y >> 8) & 0xFF);
-    writeBYTEfast(y & 0xFF);
-    writeBYTEfast((w >> 8) & 0xFF);
-    writeBYTE(w & 0xFF);
-    writeBYTE((h >> 8) & 0xFF);
-    writeBYTE(h & 0xFF);
-    wait_ms(1);
+    startBLIT(x, y, w, h);
     for (int i=0; i<w*h; i++) {
         red5   = (colors[i] >> (16 + 3)) & 0x1F;              // get red on 5 bits
         green6 = (colors[i] >> (8 + 2))  & 0x3F;              // get green on 6 bits
@@ -241,58 +231,56 @@ void uLCD_4DGL :: BLIT(int x, int y, int w, int h, int *colors)     // draw a bl
         writeBYTEfast(((red5 << 3)   + (green6 >> 3)) & 0xFF);  // first part of 16 bits color
         writeBYTEfast(((green6 << 5) + (blue5 >> 0)) & 0xFF);  // second part of 16 bits color
     }
-    int resp=0;
-    while (!_cmd.readable()) wait_ms(TEMPO);              // wait for screen answer
-    if (_cmd.readable()) resp = _cmd.getc();           // read response if any
-    switch (resp) {
-        case ACK :                                     // if OK return   1
-            resp =  1;
-            break;
-        case NAK :                                     // if NOK return -1
-            resp = -1;
-            break;
-        default :
-            resp =  0;                                 // else return   0
-            break;
+    finishBLIT();
+}
+//******************************************************************************************************
+void uLCD_4DGL :: BLIT565(int x, int y, int w, int h, const unsigned char *pixels)     // draw a block of pre-packed pixels
+{
+    startBLIT(x, y, w, h);
+    for (int i=0; i<w*h*2; i++) {
+        writeBYTEfast(pixels[i]);                      // already big-endian RGB565
     }
-#if DEBUGMODE
-    pc.printf("   Answer received : %d\n",resp);
-#endif
-
+    finishBLIT();
+}
+//******************************************************************************************************
+void uLCD_4DGL :: startBLIT(int x, int y, int w, int h)     // queue the header of a blit
+{
+    blit_start = _lcd_timer.read_us();
+    beginCOMMAND(BLITCOM, 10);                         // pixels wait for the screen to set up
+    writeBYTEfast('\x00');
+    writeBYTEfast(BLITCOM);
+    writeBYTEfast((x >> 8) & 0xFF);
+    writeBYTEfast(x & 0xFF);
+    writeBYTEfast((y >> 8) & 0xFF);
+    writeBYTEfast(y & 0xFF);
+    writeBYTEfast((w >> 8) & 0xFF);
+    writeBYTEfast(w & 0xFF);
+    writeBYTEfast((h >> 8) & 0xFF);
+    writeBYTEfast(h & 0xFF);
+}
+//******************************************************************************************************
+void uLCD_4DGL :: finishBLIT(void)     // the pixels are queued, the ACK is collected by rxIRQ
+{
+    endCOMMAND();
+    unsigned int us = _lcd_timer.read_us() - blit_start;
+    blit_us += us;
+    if (us > blit_max_us) blit_max_us = us;
+    blit_count++;
 }
 //******************************************************************************************************
 int uLCD_4DGL :: read_pixel(int x, int y)   // read screen info and populate data
 {
 
-    char command[6]= "";
-    command[0] = 0xFF;
-    command[1] = READPIXEL;
-
-    command[2] = (x >> 8) & 0xFF;
-    command[3] = x & 0xFF;
-
-    command[4] = (y >> 8) & 0xFF;
-    command[5] = y & 0xFF;
-
-    int i, temp = 0, color = 0, resp = 0;
-    char response[2] = "";
+    char command[5]= "";
+    command[0] = READPIXEL;
 
-    freeBUFFER();
-
-    for (i = 0; i < 6; i++) {                   // send all chars to serial port
-        writeBYTE(command[i]);
-    }
-
-    while (!_cmd.readable()) wait_ms(TEMPO);    // wait for screen answer
-
-    while (_cmd.readable() && resp < ARRAY_SIZE(response)) {
-        temp = _cmd.getc();
-        response[resp++] = (char)temp;
-    }
+    command[1] = (x >> 8) & 0xFF;
+    command[2] = x & 0xFF;
 
-    color = ((response[0] << 8) + response[1]);
+    command[3] = (y >> 8) & 0xFF;
+    command[4] = y & 0xFF;
 
-    return color; // WARNING : this is 16bits color, not 24bits... need to be fixed
+    return readWORD(command, 5); // WARNING : this is 16bits color, not 24bits... need to be fixed
 }
 
 
@@ -26,16 +26,9 @@
 //******************************************************************************************************
 int uLCD_4DGL :: media_init()
 {
-    int resp = 0;
     char command[1] = "";
     command[0] = MINIT;
-    writeCOMMAND(command, 1);
-    while (!_cmd.readable()) wait_ms(TEMPO);              // wait for screen answer
-    if (_cmd.readable()) {
-        resp = _cmd.getc();           // read response
-        resp = resp << 8 + _cmd.getc();
-    }
-    return resp;
+    return readWORD(command, 1);
 }
 
 //******************************************************************************************************
@@ -70,31 +63,17 @@ void uLCD_4DGL :: set_sector_address(int hi, int lo)
 //******************************************************************************************************
 char uLCD_4DGL :: read_byte()
 {
-    char resp = 0;
     char command[1] = "";
     command[0] = READBYTE;
-    writeCOMMAND(command, 1);
-    while (!_cmd.readable()) wait_ms(TEMPO);              // wait for screen answer
-    if (_cmd.readable()) {
-        resp = _cmd.getc();           // read response
-        resp = _cmd.getc();
-    }
-    return resp;
+    return readWORD(command, 1) & 0xFF;
 }
 
 //******************************************************************************************************
 int  uLCD_4DGL :: read_word()
 {
-    int resp=0;
     char command[1] = "";
     command[0] = READWORD;
-    writeCOMMAND(command, 1);
-    while (!_cmd.readable()) wait_ms(TEMPO);              // wait for screen answer
-    if (_cmd.readable()) {
-        resp = _cmd.getc();           // read response
-        resp = resp << 8 + _cmd.getc();
-    }
-    return resp;
+    return readWORD(command, 1);
 }
 
 //******************************************************************************************************
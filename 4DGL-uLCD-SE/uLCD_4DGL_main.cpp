@@ -22,6 +22,27 @@
 
 #define ARRAY_SIZE(X) sizeof(X)/sizeof(X[0])
 
+// Opcodes with an entry in the pacing table; calibrate_pacing() measures the
+// first ones with the matching worst-case sample command
+static const char paced_opcodes[LCD_PACED] = {
+    FRECTANGLE, RECTANGLE, LINE, PIXEL, PUTCHAR, MOVECURSOR, TEXTCOLOR,
+    TEXTMODE, TEXTWIDTH, TEXTHEIGHT, SETFONT, CLS, BLITCOM
+};
+static const char pacing_samples[LCD_PACED - 1][12] = {    // length, then the command
+    { 11, FRECTANGLE, 0, 0, 0, 0, 0, 127, 0, 127, 0, 0 },  // whole screen
+    { 11, RECTANGLE,  0, 0, 0, 0, 0, 127, 0, 127, 0, 0 },
+    { 11, LINE,       0, 0, 0, 0, 0, 127, 0, 127, 0, 0 },  // whole diagonal
+    {  7, PIXEL,      0, 0, 0, 0, 0, 0 },
+    {  3, PUTCHAR,    0, 'W' },                            // at double size
+    {  5, MOVECURSOR, 0, 0, 0, 0 },
+    {  3, TEXTCOLOR,  0, 0 },
+    {  3, TEXTMODE,   0, OPAQUE },
+    {  3, TEXTWIDTH,  0, 2 },
+    {  3, TEXTHEIGHT, 0, 2 },
+    {  3, SETFONT,    0, FONT_7X8 },
+    {  1, CLS }
+};
+
 //Serial pc(USBTX,USBRX);
 
 
@@ -33,7 +54,20 @@ uLCD_4DGL :: uLCD_4DGL(PinName tx, PinName rx, PinName rst) : _cmd(tx, rx),
 #endif // DEBUGMODE
 {
     // Constructor
+    tx_bytes = 0;
+    blit_count = blit_us = blit_max_us = tx_wait_us = tx_high_water = 0;
+    tx_head = tx_tail = cmd_head = cmd_tail = cmd_done = rx_head = rx_tail = 0;
+    tx_errors = cmd_open = reply_left = hold_active = tx_partial = feeding = 0;
+    for (int i = 0; i < LCD_PACED; i++) {
+        pacing[i].opcode = paced_opcodes[i];
+        pacing[i].gap_us = LCD_PACE_ACK;                // until calibrated
+        pacing[i].setup_us = paced_opcodes[i] == BLITCOM ? 1000 : 0;
+    }
+    _lcd_timer.start();
+    current_baud = 9600;
     _cmd.baud(9600);
+    _cmd.attach(this, &uLCD_4DGL::rxIRQ, Serial::RxIrq);
+    _cmd.attach(this, &uLCD_4DGL::txIRQ, Serial::TxIrq);
 #if DEBUGMODE
     pc.baud(115200);
 
@@ -58,71 +92,299 @@ uLCD_4DGL :: uLCD_4DGL(PinName tx, PinName rx, PinName rst) : _cmd(tx, rx),
 
 //******************************************************************************************************
 void uLCD_4DGL :: writeBYTE(char c)   // send a BYTE command to screen
+{
+    // Commands are paced as a whole from the pacing table and the screen's
+    // ACKs, so bytes are no longer delayed one by one
+    writeBYTEfast(c);
+}
+
+//******************************************************************************************************
+void uLCD_4DGL :: writeBYTEfast(char c)   // queue a BYTE command for the screen
 {
 
-    _cmd.putc(c);
-    wait_us(500);  //mbed is too fast for LCD at high baud rates in some long commands
+    if (tx_head - tx_tail >= LCD_TX_QUEUE) {
+        int start = _lcd_timer.read_us();
+        while (tx_head - tx_tail >= LCD_TX_QUEUE) kickTX();   // wait for the interrupt to make room
+        tx_wait_us += _lcd_timer.read_us() - start;
+    }
+    tx_ring[tx_head & (LCD_TX_QUEUE - 1)] = c;
+    tx_head++;
+    tx_bytes++;
+    if (tx_head - tx_tail > tx_high_water) tx_high_water = tx_head - tx_tail;
 
 #if DEBUGMODE
-    pc.printf("   Char sent : 0x%02X\n",c);
+    pc.printf("   Char queued : 0x%02X\n",c);
 #endif
 
 }
+//******************************************************************************************************
+static int replyLength(char opcode)   // bytes the screen answers a command with
+{
 
+    switch (opcode) {
+        case BCKGDCOLOR :                              // setters answer ACK and the old value
+        case TXTBCKGDCOLOR :
+        case TEXTCOLOR :
+        case SETFONT :
+        case TEXTWIDTH :
+        case TEXTHEIGHT :
+        case TEXTMODE :
+        case TEXTBOLD :
+        case TEXTITALIC :
+        case TEXTINVERSE :
+        case TEXTUNDERLINE :
+        case PENSIZE :
+        case DISPPOWER :
+        case TEXTSTRING :                              // ACK and the length printed
+        case MINIT :                                   // ACK and the result
+        case READBYTE :
+        case READWORD :
+            return 3;
+        default :
+            return 1;                                  // ACK
+    }
+}
 //******************************************************************************************************
-void uLCD_4DGL :: writeBYTEfast(char c)   // send a BYTE command to screen
+void uLCD_4DGL :: beginCOMMAND(char opcode, int header)   // open a command; its bytes are queued next
 {
 
-    _cmd.putc(c);
-    //wait_ms(0.0);  //mbed is too fast for LCD at high baud rates - but not in short commands
+    // The interrupt may start sending the command before it is complete, so
+    // how to pace it has to be known before its first byte is queued
+    while (cmd_head - cmd_done >= LCD_CMD_QUEUE) kickTX();
+    unsigned int c = cmd_head & (LCD_CMD_QUEUE - 1);
+    cmd_pace[c] = pacingIndex(opcode);
+    cmd_reply[c] = replyLength(opcode);
+    cmd_setup[c] = tx_head + header;                   // no header: never reached after a byte is sent
+    cmd_open = 1;
+}
+//******************************************************************************************************
+void uLCD_4DGL :: endCOMMAND(void)   // the bytes queued since beginCOMMAND make up the command
+{
 
-#if DEBUGMODE
-    pc.printf("   Char sent : 0x%02X\n",c);
-#endif
+    __disable_irq();
+    cmd_end[cmd_head & (LCD_CMD_QUEUE - 1)] = tx_head;
+    cmd_head++;
+    cmd_open = 0;
+    if (tx_tail == tx_head) commandSent();             // the interrupt already sent all of it
+    pumpTX();
+    __enable_irq();
+}
+//******************************************************************************************************
+void uLCD_4DGL :: kickTX(void)   // start sending if the UART has gone idle
+{
 
+    __disable_irq();
+    checkAnswer();
+    pumpTX();
+    __enable_irq();
 }
 //******************************************************************************************************
-void uLCD_4DGL :: freeBUFFER(void)         // Clear serial buffer before writing command
+void uLCD_4DGL :: pumpTX(void)   // move queued bytes into the UART, with interrupts off
 {
 
-    while (_cmd.readable()) _cmd.getc();  // clear buffer garbage
+    // While zeros are being fed, only a command already partly sent goes on
+    while (tx_tail != tx_head && cmd_tail - cmd_done <= LCD_OUTSTANDING && (!feeding || tx_partial)
+           && _cmd.writeable()) {
+        if (hold_active && tx_tail == hold_at) {
+            if (!hold_timed || hold_until - _lcd_timer.read_us() > 0) return;
+            hold_active = 0;
+        }
+        _cmd.putc(tx_ring[tx_tail & (LCD_TX_QUEUE - 1)]);
+        tx_tail++;
+        if (cmd_tail != cmd_head || cmd_open) {        // the byte belongs to a command
+            unsigned int c = cmd_tail & (LCD_CMD_QUEUE - 1);
+            tx_partial = 1;
+            if (tx_tail == cmd_setup[c] && cmd_pace[c] >= 0)
+                holdTX(pacing[cmd_pace[c]].setup_us, 0);
+            if (cmd_tail != cmd_head && tx_tail == cmd_end[c])
+                commandSent();
+        }
+    }
 }
+//******************************************************************************************************
+void uLCD_4DGL :: commandSent(void)   // the last byte of the oldest command is out
+{
 
+    int p = cmd_pace[cmd_tail & (LCD_CMD_QUEUE - 1)];
+    sent_us = _lcd_timer.read_us();
+    cmd_sent[cmd_tail & (LCD_CMD_QUEUE - 1)] = sent_us;
+    cmd_tail++;                                        // its answer is now due
+    tx_partial = 0;
+    holdTX(p >= 0 ? pacing[p].gap_us : LCD_PACE_ACK, 1);
+}
 //******************************************************************************************************
-int uLCD_4DGL :: writeCOMMAND(char *command, int number)   // send several BYTES making a command and return an answer
+void uLCD_4DGL :: commandAnswered(void)   // the oldest command sent is answered, or given up on
+{
+
+    cmd_done++;
+    reply_left = 0;
+    feeding = 0;
+    answered_us = _lcd_timer.read_us();
+    if (cmd_done == cmd_tail && hold_active && hold_ack)
+        hold_active = 0;                               // the screen is idle: skip the rest of the gap
+    pumpTX();                                          // the next command may have been held back
+}
+//******************************************************************************************************
+void uLCD_4DGL :: checkAnswer(void)   // recover from an answer that is overdue, with interrupts off
+{
+
+    if (cmd_done == cmd_tail) return;
+    int now = _lcd_timer.read_us();
+    int late = now - cmd_sent[cmd_done & (LCD_CMD_QUEUE - 1)] - LCD_ANSWER_TIMEOUT;
+    if (late < 0) return;
+    if (!feeding) {
+        // The screen lost bytes of the command and is still waiting for
+        // them, or its answer was lost. Either way feeding it zeros, as
+        // blitWorks does, makes it answer: the missing pixels, or a NAK to
+        // a pair of zeros. An even number of them leaves no stray prefix
+        tx_errors++;
+        feeding = 1;
+        fed_count = 0;
+        fed_us = now - 1000;
+    }
+    if (late > LCD_ANSWER_TIMEOUT) {
+        commandAnswered();                             // still nothing: give up on it
+    } else if (now - fed_us >= 1000 && fed_count < LCD_RX_BUFFER && !tx_partial && _cmd.writeable()) {
+        _cmd.putc(0);
+        tx_bytes++;
+        fed_count++;
+        fed_us = now;
+    }
+}
+//******************************************************************************************************
+void uLCD_4DGL :: holdTX(int us, int ack)   // keep the next byte back while the screen is busy
+{
+
+    if (us == 0) return;
+    hold_at = tx_tail;
+    hold_ack = ack;
+    hold_timed = us != LCD_PACE_ACK;
+    hold_active = 1;
+    if (hold_timed) {
+        hold_until = _lcd_timer.read_us() + us;
+        _pace.attach_us(this, &uLCD_4DGL::kickTX, us);
+    }
+}
+//******************************************************************************************************
+int uLCD_4DGL :: pacingIndex(char opcode)   // pacing entry for an opcode, -1 if it has none
+{
+
+    for (int i = 0; i < LCD_PACED; i++)
+        if (pacing[i].opcode == opcode) return i;
+    return -1;
+}
+//******************************************************************************************************
+int uLCD_4DGL :: paceGap(int service_us)   // gap after which the next command arrives as the screen frees up
+{
+
+    int fill_us = LCD_RX_BUFFER * 10 * 1000000 / current_baud;   // time to fill its input buffer
+    int gap = service_us + service_us / 4 - fill_us;   // with a 25% margin
+    if (gap < 0) gap = 0;
+    if (gap > LCD_PACE_ACK) gap = LCD_PACE_ACK;
+    return gap;
+}
+//******************************************************************************************************
+void uLCD_4DGL :: txIRQ(void)   // UART transmit buffer empty
+{
+
+    pumpTX();
+}
+//******************************************************************************************************
+void uLCD_4DGL :: rxIRQ(void)   // UART received an answer
+{
+
+    while (_cmd.readable()) {
+        char c = _cmd.getc();
+        if (cmd_done != cmd_tail) {                    // answer to the oldest command sent
+            if (!reply_left) {
+                reply_left = cmd_reply[cmd_done & (LCD_CMD_QUEUE - 1)];
+                if (c != ACK) {                        // a NAK carries no value
+                    if (!feeding) tx_errors++;         // a late answer was counted already
+                    reply_left = 1;
+                }
+            }
+            if (--reply_left) continue;
+            commandAnswered();
+        } else if (rx_head - rx_tail < LCD_RX_QUEUE) {
+            rx_ring[rx_head & (LCD_RX_QUEUE - 1)] = c;
+            rx_head++;
+        }
+    }
+}
+//******************************************************************************************************
+int uLCD_4DGL :: rxReadable(void)   // an answer to a synchronous read has arrived
+{
+
+    return rx_head != rx_tail;
+}
+//******************************************************************************************************
+char uLCD_4DGL :: rxGetc(void)   // read an answer to a synchronous read, NAK if none comes
+{
+
+    int start = _lcd_timer.read_us();
+    while (rx_head == rx_tail) {
+        if (_lcd_timer.read_us() - start >= LCD_ANSWER_TIMEOUT) {
+            tx_errors++;
+            return NAK;
+        }
+        wait_ms(TEMPO);
+    }
+    char c = rx_ring[rx_tail & (LCD_RX_QUEUE - 1)];
+    rx_tail++;
+    return c;
+}
+//******************************************************************************************************
+void uLCD_4DGL :: drainTX(void)   // wait until everything queued is sent and answered, or given up on
+{
+
+    int start = _lcd_timer.read_us();
+    while (tx_tail != tx_head || cmd_done != cmd_tail) kickTX();
+    tx_wait_us += _lcd_timer.read_us() - start;
+}
+//******************************************************************************************************
+int uLCD_4DGL :: flush()   // wait for the queue to empty and report commands not ACKed
+{
+
+    drainTX();
+    int errors = tx_errors;
+    tx_errors = 0;
+    return errors;
+}
+//******************************************************************************************************
+int uLCD_4DGL :: queue_depth()
+{
+
+    return tx_head - tx_tail;
+}
+//******************************************************************************************************
+int uLCD_4DGL :: pending_commands()
+{
+
+    return cmd_head - cmd_done;
+}
+//******************************************************************************************************
+void uLCD_4DGL :: freeBUFFER(void)         // Clear serial buffer before a synchronous read
+{
+
+    drainTX();                            // answers to queued commands are not garbage
+    rx_tail = rx_head;                    // clear buffer garbage
+}
+
+//******************************************************************************************************
+int uLCD_4DGL :: writeCOMMAND(char *command, int number)   // queue several BYTES making a command
 {
 
 #if DEBUGMODE
     pc.printf("\n");
     pc.printf("New COMMAND : 0x%02X\n", command[0]);
 #endif
-    int i, resp = 0;
-    freeBUFFER();
+    int i;
+    beginCOMMAND(command[0], 0);
     writeBYTE(0xFF);
-    for (i = 0; i < number; i++) {
-        if (i<16)
-            writeBYTEfast(command[i]); // send command to serial port
-        else
-            writeBYTE(command[i]); // send command to serial port but slower
-    }
-    while (!_cmd.readable()) wait_ms(TEMPO);              // wait for screen answer
-    if (_cmd.readable()) resp = _cmd.getc();           // read response if any
-    switch (resp) {
-        case ACK :                                     // if OK return   1
-            resp =  1;
-            break;
-        case NAK :                                     // if NOK return -1
-            resp = -1;
-            break;
-        default :
-            resp =  0;                                 // else return   0
-            break;
-    }
-#if DEBUGMODE
-    pc.printf("   Answer received : %d\n",resp);
-#endif
+    for (i = 0; i < number; i++) writeBYTEfast(command[i]);    // queue all bytes for the serial port
+    endCOMMAND();                                      // answer is collected by rxIRQ
 
-    return resp;
+    return 1;
 }
 
 //**************************************************************************
@@ -137,40 +399,20 @@ void uLCD_4DGL :: reset()    // Reset Screen
     freeBUFFER();           // clean buffer from possible garbage
 }
 //******************************************************************************************************
-int uLCD_4DGL :: writeCOMMANDnull(char *command, int number)   // send several BYTES making a command and return an answer
+int uLCD_4DGL :: writeCOMMANDnull(char *command, int number)   // queue several BYTES making a command
 {
 
 #if DEBUGMODE
     pc.printf("\n");
     pc.printf("New COMMAND : 0x%02X\n", command[0]);
 #endif
-    int i, resp = 0;
-    freeBUFFER();
+    int i;
+    beginCOMMAND(command[0], 0);
     writeBYTE(0x00); //command has a null prefix byte
-    for (i = 0; i < number; i++) {
-        if (i<16) //don't overflow LCD UART buffer
-            writeBYTEfast(command[i]); // send command to serial port
-        else
-            writeBYTE(command[i]); // send command to serial port with delay
-    }
-    while (!_cmd.readable()) wait_ms(TEMPO);              // wait for screen answer
-    if (_cmd.readable()) resp = _cmd.getc();           // read response if any
-    switch (resp) {
-        case ACK :                                     // if OK return   1
-            resp =  1;
-            break;
-        case NAK :                                     // if NOK return -1
-            resp = -1;
-            break;
-        default :
-            resp =  0;                                 // else return   0
-            break;
-    }
-#if DEBUGMODE
-    pc.printf("   Answer received : %d\n",resp);
-#endif
+    for (i = 0; i < number; i++) writeBYTEfast(command[i]);    // queue all bytes for the serial port
+    endCOMMAND();                                      // answer is collected by rxIRQ
 
-    return resp;
+    return 1;
 }
 
 //**************************************************************************
@@ -294,15 +536,17 @@ void uLCD_4DGL :: baudrate(int speed)    // set screen baud rate
     command[2] = char(newbaud % 256);
     wait_ms(1);
     for (i = 0; i <3; i++) writeBYTEfast(command[i]);      // send command to serial port
+    drainTX();
     for (i = 0; i<10; i++) wait_ms(1); 
     //dont change baud until all characters get sent out
     _cmd.baud(speed);                                  // set mbed to same speed
-    i=0;
-    while ((!_cmd.readable()) && (i<25000)) {
+    current_baud = speed;
+    int start = _lcd_timer.read_us();
+    while ((!rxReadable()) && (_lcd_timer.read_us() - start < 200000)) {
         wait_ms(TEMPO);           // wait for screen answer - comes 100ms after change
-        i++; //timeout if ack character missed by baud change
+        //timeout if ack character missed by baud change
     }
-    if (_cmd.readable()) resp = _cmd.getc();           // read response if any
+    if (rxReadable()) resp = rxGetc();           // read response if any
     switch (resp) {
         case ACK :                                     // if OK return   1
             resp =  1;
@@ -326,11 +570,14 @@ int uLCD_4DGL :: readVERSION(char *command, int number)   // read screen info an
     freeBUFFER();
 
     for (i = 0; i < number; i++) writeBYTE(command[i]);    // send all chars to serial port
+    drainTX();
 
-    while (!_cmd.readable()) wait_ms(TEMPO);               // wait for screen answer
+    int start = _lcd_timer.read_us();
+    while (!rxReadable() && _lcd_timer.read_us() - start < LCD_ANSWER_TIMEOUT)
+        wait_ms(TEMPO);                                // wait for screen answer
 
-    while (_cmd.readable() && resp < ARRAY_SIZE(response)) {
-        temp = _cmd.getc();
+    while (rxReadable() && resp < ARRAY_SIZE(response)) {
+        temp = rxGetc();
         response[resp++] = (char)temp;
     }
     switch (resp) {
@@ -429,6 +676,22 @@ void uLCD_4DGL :: set_volume(char value)     // set sound volume to value
 }
 
 
+//******************************************************************************************************
+int uLCD_4DGL :: readWORD(char *command, int number)   // send a command and return the word it answers with
+{
+
+    int i, resp;
+
+    freeBUFFER();
+    writeBYTE(0xFF);
+    for (i = 0; i < number; i++) writeBYTE(command[i]);    // send all chars to serial port
+    drainTX();
+
+    if (rxGetc() != ACK) return -1;
+    resp = (unsigned char)rxGetc() << 8;
+    return resp + (unsigned char)rxGetc();
+}
+
 //******************************************************************************************************
 int uLCD_4DGL :: getSTATUS(char *command, int number)   // read screen info and populate data
 {
@@ -444,11 +707,14 @@ int uLCD_4DGL :: getSTATUS(char *command, int number)   // read screen info and
     freeBUFFER();
 
     for (i = 0; i < number; i++) writeBYTE(command[i]);    // send all chars to serial port
+    drainTX();
 
-    while (!_cmd.readable()) wait_ms(TEMPO);    // wait for screen answer
+    int start = _lcd_timer.read_us();
+    while (!rxReadable() && _lcd_timer.read_us() - start < LCD_ANSWER_TIMEOUT)
+        wait_ms(TEMPO);                                // wait for screen answer
 
-    while (_cmd.readable() && resp < ARRAY_SIZE(response)) {
-        temp = _cmd.getc();
+    while (rxReadable() && resp < ARRAY_SIZE(response)) {
+        temp = rxGetc();
         response[resp++] = (char)temp;
     }
     switch (resp) {
@@ -467,3 +733,72 @@ int uLCD_4DGL :: getSTATUS(char *command, int number)   // read screen info and
     return resp;
 }
 
+//******************************************************************************************************
+int uLCD_4DGL :: blitWorks()   // draw a test tile and check the screen answered it in time
+{
+
+    static const unsigned char tile[11*11*2] = { 0 };
+    drainTX();
+    BLIT565(0, 0, 11, 11, tile);
+    int start = _lcd_timer.read_us();
+    while ((tx_tail != tx_head || cmd_done != cmd_tail) && _lcd_timer.read_us() - start < 50000) kickTX();
+    if (cmd_done != cmd_tail) {
+        // The screen lost pixels and is still waiting for them: feed it
+        // zeros until it answers
+        hold_active = 0;
+        for (int i = 0; i < 11*11*2 && cmd_done != cmd_tail; i++) {
+            writeBYTEfast(0);
+            kickTX();
+            wait_ms(1);
+        }
+        flush();
+        return 0;
+    }
+    return flush() == 0;
+}
+//******************************************************************************************************
+void uLCD_4DGL :: calibrate_pacing()   // measure service times and set the pacing table from them
+{
+
+    int i, j;
+    int errors = tx_errors;                            // the flushes below clear it
+
+    // Measure each opcode alone: send its worst-case sample a few times and
+    // time the answer from the command's last byte
+    for (i = 0; i < LCD_PACED; i++) pacing[i].gap_us = LCD_PACE_ACK;
+    text_width(2);                                     // largest text the game draws
+    text_height(2);
+    for (i = 0; i < LCD_PACED - 1; i++) {
+        int worst = 0;
+        for (j = 0; j < 4; j++) {
+            drainTX();
+            writeCOMMAND((char *)pacing_samples[i] + 1, pacing_samples[i][0]);
+            drainTX();
+            if (answered_us - sent_us > worst) worst = answered_us - sent_us;
+        }
+        pacing[i].gap_us = paceGap(worst);
+    }
+    errors += flush();
+
+    // Blit pixels may follow the header once the screen has set up for
+    // them. Search for the shortest setup that still draws, starting from
+    // the 1 ms the driver always waited, then time the blit itself
+    int b = pacingIndex(BLITCOM);
+    int lo = 0, hi = pacing[b].setup_us;
+    while (hi - lo > 10) {
+        pacing[b].setup_us = (lo + hi) / 2;
+        if (blitWorks()) hi = pacing[b].setup_us;
+        else lo = pacing[b].setup_us;
+    }
+    pacing[b].setup_us = hi + hi / 4;
+    blitWorks();
+    pacing[b].gap_us = paceGap(answered_us - sent_us);
+    tx_errors = errors;                                // trials that lost pixels were meant to
+#ifdef MBED_HOST
+    host_lcd_calibrated();
+#endif
+
+    text_width(1);
+    text_height(1);
+    cls();
+}
@@ -127,6 +127,27 @@ int MMA8452::setBitDepth(BitDepth depth,int toggleActivation) {
    );
 }
 
+int MMA8452::enableDataReadyInterrupt(int int1, int toggleActivation) {
+   // Both registers can only be written in standby
+   if(toggleActivation) {
+       if(standby()) {
+          return 1;
+       }
+   }
+   if(maskAndApplyRegister(MMA8452_CTRL_REG_5,MMA8452_INT_CFG_DRDY_MASK,int1 ? 0x01 : 0x00,0)) {
+      return 1;
+   }
+   if(maskAndApplyRegister(MMA8452_CTRL_REG_4,MMA8452_INT_EN_DRDY_MASK,0x01,0)) {
+      return 1;
+   }
+   if(toggleActivation) {
+       if(activate()) {
+          return 1;
+       }
+   }
+   return 0;
+}
+
 char MMA8452::getMaskedRegister(int addr, char mask) {
    char rval = 0;
    if(readRegister(addr,&rval)) {
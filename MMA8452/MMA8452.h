@@ -102,6 +102,10 @@
 #define MMA8452_BIT_DEPTH_MASK 0xFD
 #define MMA8452_BIT_DEPTH_MASK_SHIFT 0x01
 
+// masks for the data ready interrupt (CTRL_REG_4 enables it, CTRL_REG_5 routes it to INT1)
+#define MMA8452_INT_EN_DRDY_MASK 0xFE
+#define MMA8452_INT_CFG_DRDY_MASK 0xFE
+
 // status masks and shifts
 #define MMA8452_STATUS_ZYXDR_MASK 0x08
 #define MMA8452_STATUS_ZDR_MASK 0x04
@@ -294,6 +298,14 @@ class MMA8452 {
       int setBitDepth(BitDepth depth, int toggleActivation=1);
       int setDataRate(DataRateHz dataRate, int toggleActivation=1);
       
+      /**
+       * Signal each new sample on an interrupt pin, INT1 if int1 is set and INT2 otherwise.
+       * The pin is driven low (the default polarity) from when a sample is ready until it is read.
+       *
+       * @return 0 on success, 1 on failure.
+       */
+      int enableDataReadyInterrupt(int int1=1, int toggleActivation=1);
+      
       DynamicRange getDynamicRange();
       DataRateHz getDataRate();
       BitDepth getBitDepth();
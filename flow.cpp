@@ -0,0 +1,379 @@
+#include "flow.h"
+#include "globals.h"
+#include "map.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The distance of each cell, row by row, the queue of cells still to expand,
+ * which is at most every cell once, and a bit per cell marking the cells a
+ * repair has queued. They grow to fit the largest map the field has been
+ * computed on.
+ */
+static unsigned char* dist;
+static unsigned short* queue;
+static unsigned char* marks;
+static int cells;
+#if CHECK_FLOW_REPAIRS
+static unsigned char* repaired;
+#endif
+
+/**
+ * What the field was last computed for. A map of -1 means it never was.
+ */
+static int width, height;
+static int target_x, target_y;
+static int target_map = -1;
+
+static FlowStats stats;
+static bool listening;
+
+#define MARKED(c)   (marks[(c) >> 3] & (1 << ((c) & 7)))
+#define MARK(c)     (marks[(c) >> 3] |= 1 << ((c) & 7))
+#define UNMARK(c)   (marks[(c) >> 3] &= ~(1 << ((c) & 7)))
+
+/**
+ * Put (x, y) on the queue at distance d, if it is empty and not yet reached.
+ */
+static void visit(int x, int y, int d, int* tail)
+{
+    int c = y * width + x;
+    if (dist[c] != FLOW_UNREACHABLE || !map_empty(x, y))
+        return;
+    dist[c] = d;
+    queue[(*tail)++] = c;
+}
+
+/**
+ * Breadth-first search of the whole map from the target. Returns the cells
+ * reached.
+ */
+static int recompute()
+{
+    // The target itself counts, whatever is on it
+    memset(dist, FLOW_UNREACHABLE, width * height);
+    int head = 0, tail = 0;
+    if (target_x >= 0 && target_y >= 0 && target_x < width && target_y < height) {
+        dist[target_y * width + target_x] = 0;
+        queue[tail++] = target_y * width + target_x;
+    }
+    while (head < tail) {
+        int c = queue[head++];
+        int d = dist[c] + 1;
+        if (d > FLOW_MAX)
+            break;      // Every cell left on the queue is as far
+        int cx = c % width, cy = c / width;
+        if (cx + 1 < width)  visit(cx + 1, cy, d, &tail);
+        if (cy + 1 < height) visit(cx, cy + 1, d, &tail);
+        if (cx > 0)          visit(cx - 1, cy, d, &tail);
+        if (cy > 0)          visit(cx, cy - 1, d, &tail);
+    }
+    return tail;
+}
+
+/**
+ * Lower cell c to distance d if that is shorter and the cell is empty, and
+ * queue it to pass the change on. The queue runs round the buffer from head,
+ * and a cell is on it at most once, so it never holds more than every cell.
+ */
+static void lower(int c, int d, int head, int* count)
+{
+    if (dist[c] <= d)
+        return;
+    // Only a cell no path reached yet can be a wall; any other one is empty
+    if (dist[c] == FLOW_UNREACHABLE && !map_empty(c % width, c / width))
+        return;
+    dist[c] = d;
+    if (MARKED(c))
+        return;
+    MARK(c);
+    queue[(head + (*count)++) % (width * height)] = c;
+}
+
+/**
+ * Pass lowered distances on from the count cells queued at head until no
+ * neighbour gets any nearer. Returns the cells expanded.
+ */
+static int relax(int head, int count)
+{
+    int n = width * height;
+    int touched = 0;
+    while (count) {
+        int c = queue[head];
+        head = (head + 1) % n;
+        count--;
+        UNMARK(c);
+        touched++;
+        int d = dist[c] + 1;
+        if (d > FLOW_MAX)
+            continue;
+        int cx = c % width, cy = c / width;
+        if (cx + 1 < width)  lower(c + 1, d, head, &count);
+        if (cy + 1 < height) lower(c + width, d, head, &count);
+        if (cx > 0)          lower(c - 1, d, head, &count);
+        if (cy > 0)          lower(c - width, d, head, &count);
+    }
+    return touched;
+}
+
+/**
+ * The shortest distance among the neighbours of c.
+ */
+static int nearest_neighbour(int c)
+{
+    int cx = c % width, cy = c / width;
+    int d = FLOW_UNREACHABLE;
+    if (cx + 1 < width  && dist[c + 1] < d)     d = dist[c + 1];
+    if (cy + 1 < height && dist[c + width] < d) d = dist[c + width];
+    if (cx > 0          && dist[c - 1] < d)     d = dist[c - 1];
+    if (cy > 0          && dist[c - width] < d) d = dist[c - width];
+    return d;
+}
+
+/**
+ * Whether a neighbour of c is at distance d.
+ */
+static bool has_neighbour_at(int c, int d)
+{
+    int cx = c % width, cy = c / width;
+    return (cx + 1 < width  && dist[c + 1] == d)
+        || (cy + 1 < height && dist[c + width] == d)
+        || (cx > 0          && dist[c - 1] == d)
+        || (cy > 0          && dist[c - width] == d);
+}
+
+/**
+ * Queue the neighbours of c at distance d that are not queued yet.
+ */
+static void queue_neighbours_at(int c, int d, int* tail)
+{
+    int cx = c % width, cy = c / width;
+    int next[4], k = 0;
+    if (cx + 1 < width)  next[k++] = c + 1;
+    if (cy + 1 < height) next[k++] = c + width;
+    if (cx > 0)          next[k++] = c - 1;
+    if (cy > 0)          next[k++] = c - width;
+    for (int i = 0; i < k; i++) {
+        if (dist[next[i]] == d && !MARKED(next[i])) {
+            MARK(next[i]);
+            queue[(*tail)++] = next[i];
+        }
+    }
+}
+
+/**
+ * Cell c no longer leads anywhere at its distance: it became a wall, or it
+ * was the target and the target moved. Find every cell whose shortest path
+ * ran through it (each is one further out than a cell found before, and has
+ * no other neighbour one nearer), then work their distances out again.
+ *
+ * When the target stepped off an empty cell onto a neighbour, which is
+ * already at 0, no distance can grow by more than one, so each orphan is
+ * simply pushed one step further out. A new wall can cut off whole regions,
+ * so then the orphans are forgotten and relaxed again from the cells around
+ * them. Returns the cells visited.
+ */
+static int raise(int c, bool blocked)
+{
+    // Find the orphans, nearest first, so that a cell's nearer neighbours are
+    // all decided before it is. A pushed orphan is no longer one nearer than
+    // the cells beyond it, so it does not keep them either.
+    int head = 0, tail = 0;
+    MARK(c);
+    queue[tail++] = c;
+    while (head < tail) {
+        int u = queue[head++];
+        int d = dist[u];
+        if (u != c && has_neighbour_at(u, d - 1))
+            continue;   // Still as near by another way
+        dist[u] = blocked || d >= FLOW_MAX ? FLOW_UNREACHABLE : d + 1;
+        if (d < FLOW_MAX)
+            queue_neighbours_at(u, d + 1, &tail);
+    }
+    int visited = tail;
+
+    // Keep the forgotten orphans, and seed each empty one from its nearest
+    // neighbour
+    int orphans = 0;
+    for (int i = 0; i < tail; i++) {
+        int u = queue[i];
+        UNMARK(u);
+        if (blocked && dist[u] == FLOW_UNREACHABLE)
+            queue[orphans++] = u;
+    }
+    int seeds = 0;
+    for (int i = 0; i < orphans; i++) {
+        int u = queue[i];
+        int d = nearest_neighbour(u) + 1;
+        if (u == c || d > FLOW_MAX)
+            continue;
+        dist[u] = d;
+        MARK(u);
+        queue[seeds++] = u;
+    }
+    return visited + orphans + relax(0, seeds);
+}
+
+/**
+ * Count a repair of touched cells.
+ */
+static void count_repair(int touched)
+{
+    stats.repairs++;
+    stats.repair_cells += touched;
+    stats.last_cells = touched;
+    if ((unsigned) touched > stats.max_repair_cells)
+        stats.max_repair_cells = touched;
+}
+
+#if CHECK_FLOW_REPAIRS
+/**
+ * Compare the field a repair left with a full recompute, and keep the latter.
+ */
+static void check_repair(const char* what, int x, int y)
+{
+    int n = width * height;
+    memcpy(repaired, dist, n);
+    recompute();
+    int wrong = 0;
+    for (int c = 0; c < n; c++)
+        if (repaired[c] != dist[c])
+            wrong++;
+    if (wrong)
+        pc.printf("flow: %s at (%d,%d) left %d cells wrong\r\n", what, x, y, wrong);
+}
+#endif
+
+/**
+ * Map listener: repair the field around a cell whose contents changed.
+ */
+static void map_changed(int x, int y)
+{
+    if (get_active_map_index() != target_map || (x == target_x && y == target_y))
+        return;
+
+    int c = y * width + x;
+    int touched;
+    PROFILE_START(PROF_FLOW);
+    if (!map_empty(x, y)) {
+        if (dist[c] == FLOW_UNREACHABLE) {
+            PROFILE_STOP(PROF_FLOW);
+            return;     // A wall, or out of reach, either way
+        }
+        touched = raise(c, true);
+    } else {
+        int d = nearest_neighbour(c) + 1;
+        if (d >= dist[c] || d > FLOW_MAX) {
+            PROFILE_STOP(PROF_FLOW);
+            return;     // Already empty, or still out of reach
+        }
+        int count = 0;
+        lower(c, d, 0, &count);
+        touched = relax(0, count);
+    }
+    count_repair(touched);
+    PROFILE_STOP(PROF_FLOW);
+#if CHECK_FLOW_REPAIRS
+    check_repair("map change", x, y);
+#endif
+}
+
+void flow_update(int x, int y)
+{
+    int map = get_active_map_index();
+    if (map == target_map && x == target_x && y == target_y)
+        return;
+
+    if (!listening) {
+        add_map_listener(map_changed);
+        listening = true;
+    }
+
+    PROFILE_START(PROF_FLOW);
+    stats.updates++;
+
+    // One step on the same map: the new target pulls every cell nearer to it
+    // down, then the cells that were only near the old one are raised
+    int dx = x - target_x, dy = y - target_y;
+    if (map == target_map && dx * dx + dy * dy == 1
+            && x >= 0 && y >= 0 && x < width && y < height
+            && target_x >= 0 && target_y >= 0 && target_x < width && target_y < height) {
+        int old = target_y * width + target_x;
+        bool blocked = !map_empty(target_x, target_y);
+        int c = y * width + x;
+        dist[c] = 0;
+        MARK(c);
+        queue[0] = c;
+        int touched = relax(0, 1);
+        target_x = x;
+        target_y = y;
+        touched += raise(old, blocked);
+        count_repair(touched);
+        PROFILE_STOP(PROF_FLOW);
+#if CHECK_FLOW_REPAIRS
+        check_repair("step", x, y);
+#endif
+        return;
+    }
+
+    int n = map_width() * map_height();
+    if (n > cells) {
+        free(dist);
+        free(queue);
+        free(marks);
+        dist = (unsigned char*) malloc(n);
+        queue = (unsigned short*) malloc(n * sizeof(unsigned short));
+        marks = (unsigned char*) calloc((n + 7) / 8, 1);
+        cells = n;
+        bool ok = dist && queue && marks;
+#if CHECK_FLOW_REPAIRS
+        free(repaired);
+        repaired = (unsigned char*) malloc(n);
+        ok = ok && repaired;
+#endif
+        if (!ok) {
+            pc.printf("OUT OF MEMORY");
+            free(dist);
+            free(queue);
+            free(marks);
+            dist = NULL;
+            queue = NULL;
+            marks = NULL;
+            cells = 0;
+            target_map = -1;
+            PROFILE_STOP(PROF_FLOW);
+            return;
+        }
+    }
+    width = map_width();
+    height = map_height();
+    target_x = x;
+    target_y = y;
+    target_map = map;
+
+    int reached = recompute();
+    stats.recomputes++;
+    stats.recompute_cells += reached;
+    stats.last_cells = reached;
+    PROFILE_STOP(PROF_FLOW);
+}
+
+int flow_distance(int x, int y)
+{
+    if (target_map < 0 || x < 0 || y < 0 || x >= width || y >= height)
+        return FLOW_UNREACHABLE;
+    return dist[y * width + x];
+}
+
+const FlowStats* flow_stats()
+{
+    return &stats;
+}
+
+void flow_report()
+{
+    pc.printf("flow: %u updates, %u full searches (%u cells), %u repairs (%u cells, at most %u), %d cells on the map\r\n",
+        stats.updates, stats.recomputes, stats.recompute_cells, stats.repairs,
+        stats.repair_cells, stats.max_repair_cells, width * height);
+}
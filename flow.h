@@ -0,0 +1,66 @@
+#ifndef FLOW_H
+#define FLOW_H
+
+/**
+ * A breadth-first distance field over the active map: how many steps each
+ * cell is from a target cell (the player), moving only through empty cells,
+ * as the ghosts do. It is shared by all the ghosts, so each ghost step is a
+ * look at its four neighbours rather than a search of its own.
+ *
+ * Distances are kept one byte per cell. Cells more than FLOW_MAX steps away
+ * count as unreachable.
+ */
+#define FLOW_MAX            254
+#define FLOW_UNREACHABLE    255
+
+/**
+ * flow_update
+ *
+ * Measure distances to (x, y) on the active map. Nothing is done if neither
+ * the target nor the active map changed since the last update. A target one
+ * step from the last one is repaired in place, and anything else is searched
+ * from scratch.
+ *
+ * Once the field has been computed, every change to the map it was computed
+ * on (see add_map_listener) repairs it straight away, re-relaxing only the
+ * cells whose distance the change can alter.
+ */
+void flow_update(int x, int y);
+
+/**
+ * flow_distance
+ *
+ * Steps from (x, y) to the target, or FLOW_UNREACHABLE (also for cells
+ * outside the map).
+ */
+int flow_distance(int x, int y);
+
+/**
+ * Counts of the work the field has done, to show what the repairs cost
+ * against searching the whole map.
+ */
+struct FlowStats {
+    unsigned int updates;           // flow_update calls that moved the target
+    unsigned int recomputes;        // full searches
+    unsigned int recompute_cells;   // cells reached by all full searches
+    unsigned int repairs;           // target steps and map changes repaired
+    unsigned int repair_cells;      // cells visited by all repairs
+    unsigned int max_repair_cells;  // most cells any one repair visited
+    unsigned int last_cells;        // cells visited by the latest search or repair
+};
+
+/**
+ * flow_stats
+ *
+ * The work done so far.
+ */
+const FlowStats* flow_stats();
+
+/**
+ * flow_report
+ *
+ * Print the work done so far to the USB console.
+ */
+void flow_report();
+
+#endif // FLOW_H
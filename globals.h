@@ -17,9 +17,10 @@ extern uLCD_4DGL uLCD;      // LCD Screen
 extern SDFileSystem sd;     // SD Card
 extern Serial pc;           // USB Console output
 extern MMA8452 acc;       // Accelerometer
-extern DigitalIn button1;   // Pushbuttons
-extern DigitalIn button2;
-extern DigitalIn button3;
+extern InterruptIn button1; // Pushbuttons
+extern InterruptIn button2;
+extern InterruptIn button3;
+extern InterruptIn button4;
 extern AnalogOut DACout;    // Speaker
 extern PwmOut speaker;
 extern wave_player waver;
@@ -33,6 +34,55 @@ extern wave_player waver;
     } \
 } while (0)
 
+// === [diagnostics] ===
+// Set to 1 (e.g. with -DRUN_BENCHMARKS=1) to benchmark the map data structures
+// at startup and print the results to the USB console
+#ifndef RUN_BENCHMARKS
+#define RUN_BENCHMARKS 0
+#endif
+
+// Set to 1 to check every map lookup against the old perimeter folding rule
+// at startup
+#ifndef CHECK_MAP_LOOKUPS
+#define CHECK_MAP_LOOKUPS 0
+#endif
+
+// Set to 1 to print the tiles redrawn, LCD bytes sent and blit timings for
+// every frame
+#ifndef REPORT_DRAW_STATS
+#define REPORT_DRAW_STATS 0
+#endif
+
+// Set to 1 to time each phase of the main loop and print min/mean/p99
+// histograms of the timings every few seconds (see profile.h)
+#ifndef PROFILE_FRAMES
+#define PROFILE_FRAMES 0
+#endif
+
+// Set REPORT_FLOW_STATS to 1 to print how many cells the ghosts' flow field
+// searched and repaired when the game ends. Set CHECK_FLOW_REPAIRS to 1 to
+// check every repair of the field against a search from scratch
+#ifndef REPORT_FLOW_STATS
+#define REPORT_FLOW_STATS 0
+#endif
+#ifndef CHECK_FLOW_REPAIRS
+#define CHECK_FLOW_REPAIRS 0
+#endif
+
+// Set RECORD_INPUTS to 1 to log every input read, and a checksum of the game
+// state after every update, to the USB console. Set REPLAY_INPUTS to 1 to
+// read the inputs back from such a log instead of the hardware, and report
+// where the game state differs from the recording
+#ifndef RECORD_INPUTS
+#define RECORD_INPUTS 0
+#endif
+#ifndef REPLAY_INPUTS
+#define REPLAY_INPUTS 0
+#endif
+#if RECORD_INPUTS && REPLAY_INPUTS
+#error "RECORD_INPUTS and REPLAY_INPUTS cannot both be set"
+#endif
+
 // === [error code] ===
 #define ERROR_NONE 0 // All good in the hood
 #define ERROR_MEH -1 // This is how errors are done
@@ -2,231 +2,218 @@
 
 #include "globals.h"
 
-//TODO: Buffer of entire screen and checking whether there was a change pixel-by-pixel
-
-static int player_sprite_right[121] = {
-0x000000, 0x000000, 0x000000, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000,
-0x000000, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000,
-0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000, 0x000000,
-0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000, 0x000000,
-0x000000, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000,
-0x000000, 0x000000, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000,
-0x000000, 0x000000, 0x000000, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000, 0x000000
+/**
+ * Sprites are stored in flash as the big-endian RGB565 byte stream the LCD
+ * takes, so drawing one needs no per-pixel conversion (see BLIT565). The
+ * tables are written in RGB888 for readability; this packs each color into
+ * its two bytes at compile time.
+ */
+#define RGB565(c) (unsigned char)((((c) >> 16) & 0xF8) | (((c) >> 13) & 0x07)), \
+                  (unsigned char)((((c) >> 5) & 0xE0) | (((c) >> 3) & 0x1F))
+
+/**
+ * Bytes in an 11x11 sprite.
+ */
+#define SPRITE_BYTES (11*11*2)
+
+
+/**
+ * The Pac-Man shape facing right, one bitmask per row with the leftmost pixel
+ * in bit 10. PacMan<R, C>::lit is pixel (R, C) of the shape as a compile-time
+ * constant, so every orientation of the player sprite can be built into a
+ * const table in flash instead of being transformed at startup.
+ */
+template <int R> struct PacManRow;
+template <> struct PacManRow<0>  { enum { bits = 0x0F8 }; }; // 00011111000
+template <> struct PacManRow<1>  { enum { bits = 0x1FC }; }; // 00111111100
+template <> struct PacManRow<2>  { enum { bits = 0x3DE }; }; // 01111011110
+template <> struct PacManRow<3>  { enum { bits = 0x7F8 }; }; // 11111111000
+template <> struct PacManRow<4>  { enum { bits = 0x7E0 }; }; // 11111100000
+template <> struct PacManRow<5>  { enum { bits = 0x780 }; }; // 11110000000
+template <> struct PacManRow<6>  { enum { bits = 0x7E0 }; }; // 11111100000
+template <> struct PacManRow<7>  { enum { bits = 0x7F8 }; }; // 11111111000
+template <> struct PacManRow<8>  { enum { bits = 0x3FE }; }; // 01111111110
+template <> struct PacManRow<9>  { enum { bits = 0x1FC }; }; // 00111111100
+template <> struct PacManRow<10> { enum { bits = 0x0F8 }; }; // 00011111000
+
+template <int R, int C> struct PacMan {
+    enum { lit = (PacManRow<R>::bits >> (10 - C)) & 1 };
 };
-static int player_sprite_left[121];
-static int player_sprite_up[121];
-static int player_sprite_down[121];
-
-static int player_sprite_with_key[121] = {
-0x000000, 0x000000, 0x000000, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000, 0x000000,
-0x000000, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000,
-0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000, 0x000000, 0x000000,
-0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000, 0x000000, 0x000000,
-0x000000, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000,
-0x000000, 0x000000, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000, 0x000000,
-0x000000, 0x000000, 0x000000, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0xff00ff, 0x000000, 0x000000, 0x000000
+
+/**
+ * Expand F(row, column, color) over every pixel of an 11x11 sprite, row by row.
+ */
+#define SPRITE_ROW(F, r, color) F(r, 0, color), F(r, 1, color), F(r, 2, color), \
+    F(r, 3, color), F(r, 4, color), F(r, 5, color), F(r, 6, color), F(r, 7, color), \
+    F(r, 8, color), F(r, 9, color), F(r, 10, color)
+#define SPRITE(F, color) SPRITE_ROW(F, 0, color), SPRITE_ROW(F, 1, color), \
+    SPRITE_ROW(F, 2, color), SPRITE_ROW(F, 3, color), SPRITE_ROW(F, 4, color), \
+    SPRITE_ROW(F, 5, color), SPRITE_ROW(F, 6, color), SPRITE_ROW(F, 7, color), \
+    SPRITE_ROW(F, 8, color), SPRITE_ROW(F, 9, color), SPRITE_ROW(F, 10, color)
+
+/**
+ * Pixel (r, c) of the player facing each direction: left mirrors the shape,
+ * down transposes it, and up mirrors down vertically.
+ */
+#define PAC_RIGHT(r, c, color) RGB565((PacMan<r, c>::lit ? (color) : 0x000000))
+#define PAC_LEFT(r, c, color)  RGB565((PacMan<r, 10-c>::lit ? (color) : 0x000000))
+#define PAC_DOWN(r, c, color)  RGB565((PacMan<c, r>::lit ? (color) : 0x000000))
+#define PAC_UP(r, c, color)    RGB565((PacMan<c, 10-r>::lit ? (color) : 0x000000))
+
+#define PLAYER_COLOR     0xffff00
+#define PLAYER_KEY_COLOR 0xff00ff
+
+static const unsigned char player_sprite_right[SPRITE_BYTES] = { SPRITE(PAC_RIGHT, PLAYER_COLOR) };
+static const unsigned char player_sprite_down[SPRITE_BYTES]  = { SPRITE(PAC_DOWN,  PLAYER_COLOR) };
+static const unsigned char player_sprite_left[SPRITE_BYTES]  = { SPRITE(PAC_LEFT,  PLAYER_COLOR) };
+static const unsigned char player_sprite_up[SPRITE_BYTES]    = { SPRITE(PAC_UP,    PLAYER_COLOR) };
+
+static const unsigned char player_key_sprite_right[SPRITE_BYTES] = { SPRITE(PAC_RIGHT, PLAYER_KEY_COLOR) };
+static const unsigned char player_key_sprite_down[SPRITE_BYTES]  = { SPRITE(PAC_DOWN,  PLAYER_KEY_COLOR) };
+static const unsigned char player_key_sprite_left[SPRITE_BYTES]  = { SPRITE(PAC_LEFT,  PLAYER_KEY_COLOR) };
+static const unsigned char player_key_sprite_up[SPRITE_BYTES]    = { SPRITE(PAC_UP,    PLAYER_KEY_COLOR) };
+
+/**
+ * The player sprites, indexed by [key][dir] (dir 0: right, 1: down, 2: left, 3: up).
+ */
+static const unsigned char* const player_sprites[2][4] = {
+    {player_sprite_right, player_sprite_down, player_sprite_left, player_sprite_up},
+    {player_key_sprite_right, player_key_sprite_down, player_key_sprite_left, player_key_sprite_up}
 };
 
-static int wall_sprite[121] = {
-0x0089ff, 0x0e77d2, 0x0089ff, 0x0089ff, 0x000000, 0x0089ff, 0x0089ff, 0x1d7aec, 0x0089ff, 0x000000, 0x0e77d2,
-0x0089ff, 0x0089ff, 0x1d7aec, 0x1d7aec, 0x000000, 0x0089ff, 0x0e77d2, 0x0089ff, 0x0089ff, 0x000000, 0x0089ff,
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0x0089ff, 0x000000, 0x0089ff, 0x1d7aec, 0x0089ff, 0x0e77d2, 0x000000, 0x0089ff, 0x0e77d2, 0x0089ff, 0x0089ff,
-0x0089ff, 0x000000, 0x0089ff, 0x0089ff, 0x0e77d2, 0x0089ff, 0x000000, 0x0089ff, 0x0089ff, 0x1d7aec, 0x0e77d2,
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0x0089ff, 0x0e77d2, 0x0089ff, 0x0089ff, 0x000000, 0x0089ff, 0x0e77d2, 0x0089ff, 0x1d7aec, 0x000000, 0x0089ff,
-0x1d7aec, 0x0089ff, 0x0089ff, 0x0e77d2, 0x000000, 0x0089ff, 0x0089ff, 0x0e77d2, 0x0089ff, 0x000000, 0x1d7aec,
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0x1d7aec, 0x000000, 0x0e77d2, 0x0089ff, 0x0089ff, 0x1d7aec, 0x000000, 0x0089ff, 0x0e77d2, 0x0089ff, 0x0089ff,
-0x0089ff, 0x000000, 0x0089ff, 0x0089ff, 0x0e77d2, 0x0089ff, 0x000000, 0x1d7aec, 0x0089ff, 0x0089ff, 0x0e77d2
+static const unsigned char wall_sprite[SPRITE_BYTES] = {
+RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x000000), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x1d7aec), RGB565(0x0089ff), RGB565(0x000000), RGB565(0x0e77d2),
+RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x1d7aec), RGB565(0x1d7aec), RGB565(0x000000), RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x000000), RGB565(0x0089ff),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x0089ff), RGB565(0x000000), RGB565(0x0089ff), RGB565(0x1d7aec), RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x000000), RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x0089ff), RGB565(0x0089ff),
+RGB565(0x0089ff), RGB565(0x000000), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x0089ff), RGB565(0x000000), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x1d7aec), RGB565(0x0e77d2),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x000000), RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x0089ff), RGB565(0x1d7aec), RGB565(0x000000), RGB565(0x0089ff),
+RGB565(0x1d7aec), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x000000), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x0089ff), RGB565(0x000000), RGB565(0x1d7aec),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x1d7aec), RGB565(0x000000), RGB565(0x0e77d2), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x1d7aec), RGB565(0x000000), RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x0089ff), RGB565(0x0089ff),
+RGB565(0x0089ff), RGB565(0x000000), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x0e77d2), RGB565(0x0089ff), RGB565(0x000000), RGB565(0x1d7aec), RGB565(0x0089ff), RGB565(0x0089ff), RGB565(0x0e77d2)
 };
 
-static int dot_sprite[121] = {
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0x000000, 0x000000, 0xffffff, 0xffffff, 0xffffff, 0x000000, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0x000000, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0x000000, 0x000000,
-0x000000, 0x000000, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0x000000, 0x000000,
-0x000000, 0x000000, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0x000000, 0x000000,
-0x000000, 0x000000, 0x000000, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0xffffff, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0x000000, 0x000000, 0xffffff, 0xffffff, 0xffffff, 0x000000, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000
+static const unsigned char dot_sprite[SPRITE_BYTES] = {
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000)
 };
 
-static int ghost_sprite_red[121] = {
-0x000000, 0x000000, 0x000000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0x000000, 0x000000,
-0x000000, 0xff0000, 0xff0000, 0xffffff, 0xff0000, 0xff0000, 0xff0000, 0xffffff, 0xff0000, 0xff0000, 0x000000,
-0x000000, 0xff0000, 0xffffff, 0xffffff, 0xffffff, 0xff0000, 0xffffff, 0xffffff, 0xffffff, 0xff0000, 0x000000,
-0xff0000, 0xff0000, 0x000000, 0xffffff, 0xffffff, 0xff0000, 0x000000, 0xffffff, 0xffffff, 0xff0000, 0xff0000,
-0xff0000, 0xff0000, 0xff0000, 0xffffff, 0xff0000, 0xff0000, 0xff0000, 0xffffff, 0xff0000, 0xff0000, 0xff0000,
-0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000,
-0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000,
-0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0xff0000,
-0xff0000, 0xff0000, 0xff0000, 0x000000, 0xff0000, 0xff0000, 0xff0000, 0x000000, 0xff0000, 0xff0000, 0xff0000,
-0x000000, 0xff0000, 0x000000, 0x000000, 0x000000, 0xff0000, 0x000000, 0x000000, 0x000000, 0xff0000, 0x000000
+static const unsigned char ghost_sprite_red[SPRITE_BYTES] = {
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xffffff), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xffffff), RGB565(0xff0000), RGB565(0xff0000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0xff0000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xff0000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xff0000), RGB565(0x000000),
+RGB565(0xff0000), RGB565(0xff0000), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xff0000), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xff0000), RGB565(0xff0000),
+RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xffffff), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xffffff), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000),
+RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000),
+RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000),
+RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000),
+RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0x000000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0x000000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000),
+RGB565(0x000000), RGB565(0xff0000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xff0000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xff0000), RGB565(0x000000)
 };
-static int ghost_sprite_yellow[121] = {
-0x000000, 0x000000, 0x000000, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0x000000,
-0x000000, 0xffff00, 0xffff00, 0xffffff, 0xffff00, 0xffff00, 0xffff00, 0xffffff, 0xffff00, 0xffff00, 0x000000,
-0x000000, 0xffff00, 0xffffff, 0xffffff, 0xffffff, 0xffff00, 0xffffff, 0xffffff, 0xffffff, 0xffff00, 0x000000,
-0xffff00, 0xffff00, 0x000000, 0xffffff, 0xffffff, 0xffff00, 0x000000, 0xffffff, 0xffffff, 0xffff00, 0xffff00,
-0xffff00, 0xffff00, 0xffff00, 0xffffff, 0xffff00, 0xffff00, 0xffff00, 0xffffff, 0xffff00, 0xffff00, 0xffff00,
-0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00,
-0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00,
-0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00, 0xffff00,
-0xffff00, 0xffff00, 0xffff00, 0x000000, 0xffff00, 0xffff00, 0xffff00, 0x000000, 0xffff00, 0xffff00, 0xffff00,
-0x000000, 0xffff00, 0x000000, 0x000000, 0x000000, 0xffff00, 0x000000, 0x000000, 0x000000, 0xffff00, 0x000000
+static const unsigned char ghost_sprite_yellow[SPRITE_BYTES] = {
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffffff), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffffff), RGB565(0xffff00), RGB565(0xffff00), RGB565(0x000000),
+RGB565(0x000000), RGB565(0xffff00), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffff00), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffff00), RGB565(0x000000),
+RGB565(0xffff00), RGB565(0xffff00), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffff00), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffff00), RGB565(0xffff00),
+RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffffff), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffffff), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00),
+RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00),
+RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00),
+RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00),
+RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0x000000), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00), RGB565(0x000000), RGB565(0xffff00), RGB565(0xffff00), RGB565(0xffff00),
+RGB565(0x000000), RGB565(0xffff00), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffff00), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffff00), RGB565(0x000000)
 };
-static int ghost_sprite_aqua[121] = {
-0x000000, 0x000000, 0x000000, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x000000, 0x000000,
-0x000000, 0x00ffff, 0x00ffff, 0xffffff, 0x00ffff, 0x00ffff, 0x00ffff, 0xffffff, 0x00ffff, 0x00ffff, 0x000000,
-0x000000, 0x00ffff, 0xffffff, 0xffffff, 0xffffff, 0x00ffff, 0xffffff, 0xffffff, 0xffffff, 0x00ffff, 0x000000,
-0x00ffff, 0x00ffff, 0x000000, 0xffffff, 0xffffff, 0x00ffff, 0x000000, 0xffffff, 0xffffff, 0x00ffff, 0x00ffff,
-0x00ffff, 0x00ffff, 0x00ffff, 0xffffff, 0x00ffff, 0x00ffff, 0x00ffff, 0xffffff, 0x00ffff, 0x00ffff, 0x00ffff,
-0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff,
-0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff,
-0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff, 0x00ffff,
-0x00ffff, 0x00ffff, 0x00ffff, 0x000000, 0x00ffff, 0x00ffff, 0x00ffff, 0x000000, 0x00ffff, 0x00ffff, 0x00ffff,
-0x000000, 0x00ffff, 0x000000, 0x000000, 0x000000, 0x00ffff, 0x000000, 0x000000, 0x000000, 0x00ffff, 0x000000
+static const unsigned char ghost_sprite_aqua[SPRITE_BYTES] = {
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0xffffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0xffffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x00ffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x00ffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x00ffff), RGB565(0x000000),
+RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x00ffff), RGB565(0x000000), RGB565(0xffffff), RGB565(0xffffff), RGB565(0x00ffff), RGB565(0x00ffff),
+RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0xffffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0xffffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff),
+RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff),
+RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff),
+RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff),
+RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x000000), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x000000), RGB565(0x00ffff), RGB565(0x00ffff), RGB565(0x00ffff),
+RGB565(0x000000), RGB565(0x00ffff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x00ffff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x00ffff), RGB565(0x000000)
 };
-static int ghost_sprite_blue[121] = {
-0x000000, 0x000000, 0x000000, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x000000, 0x000000,
-0x000000, 0x0000ff, 0x0000ff, 0x000000, 0x0000ff, 0x0000ff, 0x0000ff, 0x000000, 0x0000ff, 0x0000ff, 0x000000,
-0x000000, 0x0000ff, 0x000000, 0x000000, 0x000000, 0x0000ff, 0x000000, 0x000000, 0x000000, 0x0000ff, 0x000000,
-0x0000ff, 0x0000ff, 0xffffff, 0x000000, 0x000000, 0x0000ff, 0xffffff, 0x000000, 0x000000, 0x0000ff, 0x0000ff,
-0x0000ff, 0x0000ff, 0x0000ff, 0x000000, 0x0000ff, 0x0000ff, 0x0000ff, 0x000000, 0x0000ff, 0x0000ff, 0x0000ff,
-0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff,
-0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff,
-0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff, 0x0000ff,
-0x0000ff, 0x0000ff, 0x0000ff, 0x000000, 0x0000ff, 0x0000ff, 0x0000ff, 0x000000, 0x0000ff, 0x0000ff, 0x0000ff,
-0x000000, 0x0000ff, 0x000000, 0x000000, 0x000000, 0x0000ff, 0x000000, 0x000000, 0x000000, 0x0000ff, 0x000000
+static const unsigned char ghost_sprite_blue[SPRITE_BYTES] = {
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x000000),
+RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0xffffff), RGB565(0x000000), RGB565(0x000000), RGB565(0x0000ff), RGB565(0xffffff), RGB565(0x000000), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x0000ff),
+RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff),
+RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff),
+RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff),
+RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff),
+RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x0000ff), RGB565(0x0000ff),
+RGB565(0x000000), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x0000ff), RGB565(0x000000)
 };
 
-static int portal_sprite[121] = {
-0x000000, 0x000000, 0x000000, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x000000, 0x000000, 0x000000,
-0x000000, 0x000000, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x000000, 0x000000,
-0x000000, 0x2008db, 0x2008db, 0x7b6bf3, 0x7b6bf3, 0x7b6bf3, 0x7b6bf3, 0x2008db, 0x2008db, 0x2008db, 0x000000,
-0x2008db, 0x2008db, 0x7b6bf3, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x7b6bf3, 0x2008db, 0x2008db, 0x2008db,
-0x2008db, 0x7b6bf3, 0x2008db, 0x2008db, 0x7b6bf3, 0x7b6bf3, 0x2008db, 0x2008db, 0x7b6bf3, 0x2008db, 0x2008db,
-0x7b6bf3, 0x2008db, 0x2008db, 0x7b6bf3, 0x2008db, 0x2008db, 0x7b6bf3, 0x2008db, 0x7b6bf3, 0x2008db, 0x2008db,
-0x7b6bf3, 0x2008db, 0x2008db, 0x7b6bf3, 0x2008db, 0x7b6bf3, 0x2008db, 0x2008db, 0x7b6bf3, 0x2008db, 0x2008db,
-0x7b6bf3, 0x2008db, 0x2008db, 0x7b6bf3, 0x2008db, 0x2008db, 0x2008db, 0x7b6bf3, 0x2008db, 0x2008db, 0x2008db,
-0x000000, 0x2008db, 0x2008db, 0x2008db, 0x7b6bf3, 0x7b6bf3, 0x7b6bf3, 0x2008db, 0x2008db, 0x2008db, 0x000000,
-0x000000, 0x000000, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x000000, 0x000000,
-0x000000, 0x000000, 0x000000, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x2008db, 0x000000, 0x000000, 0x000000
+static const unsigned char portal_sprite[SPRITE_BYTES] = {
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x7b6bf3), RGB565(0x7b6bf3), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x000000),
+RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db),
+RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db),
+RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db),
+RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db),
+RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db),
+RGB565(0x000000), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x7b6bf3), RGB565(0x7b6bf3), RGB565(0x7b6bf3), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x000000), RGB565(0x000000),
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x2008db), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000)
 };
 
-static int prize_sprite[121] = {
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0xffee00, 0xffee00, 0xffee00, 0x000000, 
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0xffee00, 0xffee00, 0x000000, 0xffee00, 0x000000, 0x000000, 
-0x000000, 0x000000, 0x000000, 0x000000, 0xffee00, 0x000000, 0x000000, 0x000000, 0xffee00, 0x000000, 0x000000, 
-0x000000, 0x000000, 0x000000, 0xffee00, 0x000000, 0x000000, 0x000000, 0x000000, 0xffee00, 0x000000, 0x000000, 
-0x000000, 0x000000, 0x000000, 0xffee00, 0x000000, 0x000000, 0x000000, 0xffee00, 0x000000, 0x000000, 0x000000, 
-0x000000, 0x000000, 0xff0000, 0xff0000, 0x000000, 0x000000, 0x000000, 0xffee00, 0x000000, 0x000000, 0x000000, 
-0x000000, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0x000000, 0xff0000, 0xff0000, 0x000000, 0x000000, 0x000000, 
-0x000000, 0xff0000, 0xff0000, 0xff0000, 0xff7e7e, 0xff0000, 0xff0000, 0xff0000, 0xff0000, 0x000000, 0x000000, 
-0x000000, 0x000000, 0xff7e7e, 0xff7e7e, 0x000000, 0xff0000, 0xff0000, 0xff0000, 0xff7e7e, 0x000000, 0x000000, 
-0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0xff7e7e, 0xff7e7e, 0x000000, 0x000000, 0x000000
+static const unsigned char prize_sprite[SPRITE_BYTES] = {
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), 
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffee00), RGB565(0xffee00), RGB565(0xffee00), RGB565(0x000000), 
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffee00), RGB565(0xffee00), RGB565(0x000000), RGB565(0xffee00), RGB565(0x000000), RGB565(0x000000), 
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffee00), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffee00), RGB565(0x000000), RGB565(0x000000), 
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffee00), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffee00), RGB565(0x000000), RGB565(0x000000), 
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffee00), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffee00), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), 
+RGB565(0x000000), RGB565(0x000000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xffee00), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), 
+RGB565(0x000000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0x000000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), 
+RGB565(0x000000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff7e7e), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0x000000), RGB565(0x000000), 
+RGB565(0x000000), RGB565(0x000000), RGB565(0xff7e7e), RGB565(0xff7e7e), RGB565(0x000000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff0000), RGB565(0xff7e7e), RGB565(0x000000), RGB565(0x000000), 
+RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000), RGB565(0xff7e7e), RGB565(0xff7e7e), RGB565(0x000000), RGB565(0x000000), RGB565(0x000000)
 };    
 
 void draw_player(int u, int v, int key, int dir)
 {
-    switch (dir) {
-        case 0:
-            uLCD.BLIT(u, v, 11, 11, player_sprite_right);
-            break;
-        case 1:
-            uLCD.BLIT(u, v, 11, 11, player_sprite_down);
-            break;
-        case 2:
-            uLCD.BLIT(u, v, 11, 11, player_sprite_left);
-            break;
-        case 3:
-            uLCD.BLIT(u, v, 11, 11, player_sprite_up);
-            break;
-    }
+    uLCD.BLIT565(u, v, 11, 11, player_sprites[key ? 1 : 0][dir & 3]);
 }
 
 void draw_ghost(int u, int v, int color, int fleeing)
 {
     if (fleeing) {
-        uLCD.BLIT(u, v, 11, 11, ghost_sprite_blue);
+        uLCD.BLIT565(u, v, 11, 11, ghost_sprite_blue);
         return;
     }
     switch (color) {
         case 0:
-            uLCD.BLIT(u, v, 11, 11, ghost_sprite_red);
+            uLCD.BLIT565(u, v, 11, 11, ghost_sprite_red);
             break;
         case 1:
-            uLCD.BLIT(u, v, 11, 11, ghost_sprite_yellow);
+            uLCD.BLIT565(u, v, 11, 11, ghost_sprite_yellow);
             break;
         case 2:
-            uLCD.BLIT(u, v, 11, 11, ghost_sprite_aqua);
+            uLCD.BLIT565(u, v, 11, 11, ghost_sprite_aqua);
             break;
     }
 }
 
-void init_sprites() {
-    flip_lr(player_sprite_right, player_sprite_left);
-    transpose(player_sprite_right, player_sprite_down);
-    flip_ud(player_sprite_down, player_sprite_up);
-}
-
-void add_key_to_player() {
-    copy(player_sprite_with_key, player_sprite_right);
-    init_sprites();
-}
-
-void transpose(int *sprite, int *out)
-{
-    for (int i = 0; i < 11; i++) {
-        for (int j = 0; j < 11; j++) {
-            out[i*11+j] = sprite[j*11+i];
-        }
-    }
-}
-
-void flip_lr(int *sprite, int *out)
-{
-    for (int i = 0; i < 11; i++) {
-        for (int j = 0; j < 11; j++) {
-            out[i*11+10-j] = sprite[i*11+j];
-        }
-    }
-}
-
-void flip_ud(int *sprite, int *out)
-{
-    for (int i = 0; i < 11; i++) {
-        for (int j = 0; j < 11; j++) {
-            out[(10-i)*11+j] = sprite[i*11+j];
-        }
-    }
-}
-
-void copy(int *sprite, int *out) {
-    for (int i = 0; i < 11; i++) {
-        for (int j = 0; j < 11; j++) {
-            out[i*11+j] = sprite[i*11+j];
-        }
-    }
-}
-
 // The following colors are defined in uLCD_4DGL.h:
 // WHITE, BLACK, RED, GREEN, BLUE, LGREY, DGREY
 
@@ -257,36 +244,51 @@ void draw_nothing(int u, int v)
     uLCD.filled_rectangle(u, v, u+10, v+10, BLACK);
 }
 
+void draw_nothing_column(int u, int v, int n)
+{
+    // One command for the whole run instead of one per tile
+    uLCD.filled_rectangle(u, v, u+10, v+11*n-1, BLACK);
+}
+
 void draw_wall(int u, int v)
 {
-    uLCD.BLIT(u, v, 11, 11, wall_sprite);
+    uLCD.BLIT565(u, v, 11, 11, wall_sprite);
 }
 
 void draw_dot(int u, int v)
 {
     //uLCD.filled_rectangle(u, v, u+10, v+10, BLACK);
     //uLCD.filled_circle(u+5, v+5, 3, WHITE);
-    uLCD.BLIT(u, v, 11, 11, dot_sprite);
+    uLCD.BLIT565(u, v, 11, 11, dot_sprite);
 }
 
 void draw_tree(int u, int v)
 {
     uLCD.filled_rectangle(u, v, u+10, v+10, BLACK);
-    uLCD.pixel(u+5, v+5, WHITE);
+    draw_tree_pixels(u, v, true);
+}
+
+void draw_tree_pixels(int u, int v, int lit)
+{
+    uLCD.pixel(u+5, v+5, lit ? WHITE : BLACK);
 }
 
 void draw_portal(int u, int v)
 {
-    uLCD.BLIT(u, v, 11, 11, portal_sprite);
+    uLCD.BLIT565(u, v, 11, 11, portal_sprite);
 }
 
 void draw_prize(int u, int v) {
-    uLCD.BLIT(u, v, 11, 11, prize_sprite);
+    uLCD.BLIT565(u, v, 11, 11, prize_sprite);
 }
 
 void draw_door(int u, int v) {
     uLCD.filled_rectangle(u, v, u+10, v+10, BLACK);
-    uLCD.filled_rectangle(u, v+4, u+10, v+6, YELLOW);
+    draw_door_pixels(u, v, true);
+}
+
+void draw_door_pixels(int u, int v, int lit) {
+    uLCD.filled_rectangle(u, v+4, u+10, v+6, lit ? YELLOW : BLACK);
 }
 
 void draw_upper_status(int x, int y, int isOmni, int map, int power, int fleeing, int questState)
@@ -313,7 +315,7 @@ void draw_upper_status(int x, int y, int isOmni, int map, int power, int fleeing
         if (questState == 2)
             uLCD.printf("(%D,%D) EXIT", x, y);
         else if (fleeing)
-            uLCD.printf("(%D,%D) CHASE %Ds", x, y, fleeing / 10);
+            uLCD.printf("(%D,%D) CHASE %Ds", x, y, fleeing);
         else
             uLCD.printf("(%D,%D) RUN", x, y);
     }
@@ -363,6 +365,7 @@ void draw_dead() {
     for (int i = 3; i > 0; i--) {
         uLCD.locate(4,5);
         uLCD.printf("%D", i);
+        uLCD.flush(); // Count from when the number is on screen
         wait_ms(1000);
     }
 }
@@ -376,4 +379,5 @@ void draw_game_over() {
     uLCD.printf("GAME");
     uLCD.locate(3,3);
     uLCD.printf("OVER");
+    uLCD.flush(); // The game loop ends here, so let the queue empty
 }
@@ -1,15 +1,10 @@
 #ifndef GRAPHICS_H
 #define GRAPHICS_H
 
-void init_sprites();
-void add_key_to_player();
-void transpose(int *sprite, int *out);
-void flip_lr(int *sprite, int *out);
-void flip_ud(int *sprite, int *out);
-void copy(int *sprite, int *out);
-
 /**
  * Draws the player. This depends on the player state, so it is not a DrawFunc.
+ * key selects the sprite for a player holding the key, and dir is the
+ * direction the player faces (0: right, 1: down, 2: left, 3: up).
  */
 void draw_player(int u, int v, int key, int dir);
 
@@ -43,7 +38,22 @@ void draw_prize(int u, int v);
 void draw_door(int u, int v);
 
 /**
- * Draw the upper status bar.
+ * Fill a column of n tiles, starting with the tile at u,v, with blackness.
+ */
+void draw_nothing_column(int u, int v, int n);
+
+/**
+ * Draw only the lit pixels of the sparse tiles (trees and doors), which are
+ * otherwise black. With lit set this draws the tile onto an empty tile, and
+ * with lit clear it erases the tile back to empty, without resending the rest
+ * of the tile.
+ */
+void draw_tree_pixels(int u, int v, int lit);
+void draw_door_pixels(int u, int v, int lit);
+
+/**
+ * Draw the upper status bar. fleeing is how many more seconds the ghosts
+ * flee for, or 0 if they are not fleeing.
  */
 void draw_upper_status(int x, int y, int isOmni, int map, int power, int fleeing, int questState);
 
@@ -4,6 +4,7 @@
 #include "globals.h"
 
 #include "hardware.h"
+#include "profile.h"
 
 // We need to actually instantiate all of the globals (i.e. declare them once
 // without the extern keyword). That's what this file does!
@@ -12,30 +13,235 @@
 uLCD_4DGL uLCD(p9,p10,p11);             // LCD Screen (tx, rx, reset)
 //SDFileSystem sd(p5, p6, p7, p8, "sd");  // SD Card(mosi, miso, sck, cs)
 Serial pc(USBTX,USBRX);                 // USB Console (tx, rx)
-MMA8452 acc(p28, p27, 100000);        // Accelerometer (sda, sdc, rate)
-DigitalIn button1(p21);                 // Pushbuttons (pin)
-DigitalIn button2(p22);
-DigitalIn button3(p23);
-DigitalIn button4(p24);
+MMA8452 acc(p28, p27, 400000);        // Accelerometer (sda, sdc, rate)
+InterruptIn acc_ready(p29);             // Accelerometer data ready (INT1)
+InterruptIn button1(p21);               // Pushbuttons (pin)
+InterruptIn button2(p22);
+InterruptIn button3(p23);
+InterruptIn button4(p24);
 AnalogOut DACout(p18);                  // Speaker (pin)
 PwmOut speaker(p26);
 wave_player waver(&DACout);
 
-int b1Pressed, b2Pressed, b3Pressed, b4Pressed = 0;
+/**
+ * Button presses are caught by interrupts on the falling edge of each
+ * button's pin (the buttons are pulled up, and pressing one grounds it), so a
+ * press is not lost however briefly it is held between reads. The contacts
+ * bounce for a few milliseconds when they close or open, so once a button has
+ * changed level, its edges are ignored for DEBOUNCE_US.
+ *
+ * Each press is queued with the time it happened until read_inputs takes it.
+ * The queue has one writer (the button interrupts, which do not nest) and one
+ * reader, so it needs no locking.
+ */
+#define DEBOUNCE_US     10000
+#define BUTTON_EVENTS   16      // a power of two
+struct ButtonEvent {
+    int button;                 // 0-3 for button1-button4
+    unsigned int us;            // button_clock time of the press
+};
+static ButtonEvent button_events[BUTTON_EVENTS];
+static volatile unsigned int events_in, events_out;    // events ever queued, taken
+static unsigned int button_edge_us[4];                  // last edge that counted
+static Timer button_clock;
+
+/**
+ * A button changed level. Returns false if it is still bouncing.
+ */
+static bool button_edge(int button, unsigned int now)
+{
+    if (now - button_edge_us[button] < DEBOUNCE_US)
+        return false;
+    button_edge_us[button] = now;
+    return true;
+}
+
+template <int button>
+static void button_pressed()
+{
+    unsigned int now = button_clock.read_us();
+    if (!button_edge(button, now) || events_in - events_out == BUTTON_EVENTS)
+        return;
+    button_events[events_in % BUTTON_EVENTS].button = button;
+    button_events[events_in % BUTTON_EVENTS].us = now;
+    events_in++;
+}
+
+template <int button>
+static void button_released()
+{
+    button_edge(button, button_clock.read_us());
+}
+
+/**
+ * The accelerometer samples at TILT_RATE and pulls its INT1 pin low when each
+ * sample is ready. An interrupt reads the sample (one burst read of all three
+ * axes over I2C) into a low-pass filter, so read_inputs takes the filtered
+ * tilt without waiting on the I2C bus.
+ *
+ * The filter is a first-order IIR in fixed point: each sample moves the
+ * estimate 1/2^TILT_SMOOTHING of the way towards itself. At 50 Hz, a
+ * smoothing of 2 settles within about 100 ms, one game tick. Set it to 0 for
+ * no filtering.
+ */
+#define TILT_RATE           MMA8452::RATE_50
+#define TILT_FRACTION_BITS  8           // fraction bits of the filtered counts
+#ifndef TILT_SMOOTHING
+#define TILT_SMOOTHING      2
+#endif
+static volatile int tilt[3];            // filtered counts, x, y and z
+static volatile unsigned int tilt_samples;  // samples ever filtered
+static unsigned int tilt_samples_read;      // tilt_samples at the last read
+
+static void tilt_sample()
+{
+    int sample[3];
+    if (acc.readXYZCounts(&sample[0], &sample[1], &sample[2]))
+        return;
+    for (int a = 0; a < 3; a++) {
+        int s = sample[a] << TILT_FRACTION_BITS;
+        tilt[a] = tilt_samples ? tilt[a] + ((s - tilt[a]) >> TILT_SMOOTHING) : s;
+    }
+    tilt_samples++;
+}
+
+#if RECORD_INPUTS || REPLAY_INPUTS
+// Input logs (see RECORD_INPUTS in globals.h) have one line per record:
+//   @I <buttons> <ax> <ay> <az>  an input read: b1-b4 as bits 0-3 in hex,
+//                                tilt in 1/TILT_STEPS g
+//   @S <checksum>                the game state after an update, in hex
+//   @E                           the end of the log
+// Replays skip any other console output between them.
+#define TILT_STEPS 64
+#define TILT_STEP_COUNTS (TILT_COUNTS_PER_G / TILT_STEPS)
+static unsigned int input_count;        // inputs recorded or replayed
+static unsigned int state_count;        // states logged or checked
+#endif
+#if REPLAY_INPUTS
+static unsigned int state_mismatches;   // states that differ from the log
+#endif
+
+#if RECORD_INPUTS
+/**
+ * Round a reading to the nearest step the log holds.
+ */
+static int quantise_tilt(int a)
+{
+    int q = (a + (a < 0 ? -TILT_STEP_COUNTS : TILT_STEP_COUNTS) / 2) / TILT_STEP_COUNTS;
+    if (q < -128) q = -128;
+    if (q > 127) q = 127;
+    return q * TILT_STEP_COUNTS;
+}
+
+/**
+ * Log an input read. Tilt is rounded to what the log holds first, so the
+ * recording plays the same as its replay.
+ */
+static void record_inputs(GameInputs* in)
+{
+    in->ax = quantise_tilt(in->ax);
+    in->ay = quantise_tilt(in->ay);
+    in->az = quantise_tilt(in->az);
+    pc.printf("@I %X %d %d %d\r\n", in->b1 | in->b2 << 1 | in->b3 << 2 | in->b4 << 3,
+        in->ax / TILT_STEP_COUNTS, in->ay / TILT_STEP_COUNTS, in->az / TILT_STEP_COUNTS);
+    input_count++;
+}
+#endif
+
+#if REPLAY_INPUTS
+/**
+ * Read the next record of a kind ('I' or 'S') from the USB console into line.
+ * A record of the other kind means the replay has lost step with the log; it
+ * is skipped and counted as a mismatch. Returns false at the end of the log:
+ * its end record, since the board's console never reports end of input, or a
+ * log cut short on the host.
+ */
+static bool next_record(char kind, char* line, int size)
+{
+    for (;;) {
+        int n = 0, c;
+        while ((c = pc.getc()) >= 0 && c != '\n') {
+            if (c != '\r' && n < size - 1)
+                line[n++] = c;
+        }
+        line[n] = 0;
+        if (line[0] == '@' && line[1] == kind)
+            return true;
+        if (line[0] == '@' && line[1] == 'E')
+            return false;
+        if (line[0] == '@' && (line[1] == 'I' || line[1] == 'S'))
+            state_mismatches++;
+        if (c < 0)
+            return false;
+    }
+}
+
+/**
+ * The log has run out, so the session is over.
+ */
+static void replay_done()
+{
+    log_inputs_done();
+    exit(0);
+}
+
+static void replay_inputs(GameInputs* in)
+{
+    char line[40];
+    unsigned int buttons;
+    int x, y, z;
+    if (!next_record('I', line, sizeof(line)) ||
+        sscanf(line, "@I %x %d %d %d", &buttons, &x, &y, &z) != 4)
+        replay_done();
+    in->b1 = buttons & 1;
+    in->b2 = (buttons >> 1) & 1;
+    in->b3 = (buttons >> 2) & 1;
+    in->b4 = (buttons >> 3) & 1;
+    in->ax = x * TILT_STEP_COUNTS;
+    in->ay = y * TILT_STEP_COUNTS;
+    in->az = z * TILT_STEP_COUNTS;
+    input_count++;
+}
+#endif
 
 // Some hardware also needs to have functions called before it will set up
 // properly. Do that here.
 int hardware_init()
 {
-    // Crank up the speed
+    // Crank up the speed, then measure how fast the screen takes commands
     uLCD.baudrate(3000000);
     pc.baud(115200);
+    uLCD.calibrate_pacing();
+#if REPORT_DRAW_STATS
+    for (int i = 0; i < LCD_PACED; i++)
+        pc.printf("LCD opcode %02X: gap %u us, setup %u us\r\n", (unsigned char) uLCD.pacing[i].opcode,
+            uLCD.pacing[i].gap_us, uLCD.pacing[i].setup_us);
+#endif
         
     //Initialize pushbuttons
     button1.mode(PullUp); 
     button2.mode(PullUp);
     button3.mode(PullUp);
     button4.mode(PullUp);
+    button_clock.start();
+    button1.fall(&button_pressed<0>);
+    button2.fall(&button_pressed<1>);
+    button3.fall(&button_pressed<2>);
+    button4.fall(&button_pressed<3>);
+    button1.rise(&button_released<0>);
+    button2.rise(&button_released<1>);
+    button3.rise(&button_released<2>);
+    button4.rise(&button_released<3>);
+
+    // Start sampling the accelerometer. The pin may already be low with a
+    // sample nobody will see the edge of, so take that one by hand
+    acc.setDataRate(TILT_RATE);
+    acc.enableDataReadyInterrupt();
+    acc_ready.mode(PullUp);
+    acc_ready.fall(&tilt_sample);
+    __disable_irq();
+    tilt_sample();
+    __enable_irq();
     
     return ERROR_NONE;
 }
@@ -43,31 +249,74 @@ int hardware_init()
 GameInputs read_inputs() 
 {
     GameInputs in;
-    acc.readXYZGravity(&(in.ax), &(in.ay), &(in.az));
-    // Debounce buttons
-    if (!button1 && !b1Pressed) {
-        in.b1 = true;   
-    } else {
-        in.b1 = false;
-    }
-    b1Pressed = !button1;
-    if (!button2 && !b2Pressed) {
-        in.b2 = true;   
-    } else {
-        in.b2 = false;
-    }
-    b2Pressed = !button2;
-    if (!button3 && !b3Pressed) {
-        in.b3 = true;   
-    } else {
-        in.b3 = false;
-    }
-    b3Pressed = !button3;
-    if (!button4 && !b4Pressed) {
-        in.b4 = true;
-    } else {
-        in.b4 = false;
+#if REPLAY_INPUTS
+    replay_inputs(&in);
+    return in;
+#endif
+    // Take the filtered tilt. A failed read leaves the data-ready pin low,
+    // with no edge to come, so if no sample has arrived since the last read,
+    // check for that
+    __disable_irq();
+    if (tilt_samples == tilt_samples_read && !acc_ready)
+        tilt_sample();
+    tilt_samples_read = tilt_samples;
+    int x = tilt[0], y = tilt[1], z = tilt[2];
+    __enable_irq();
+    in.ax = (x + (1 << (TILT_FRACTION_BITS - 1))) >> TILT_FRACTION_BITS;
+    in.ay = (y + (1 << (TILT_FRACTION_BITS - 1))) >> TILT_FRACTION_BITS;
+    in.az = (z + (1 << (TILT_FRACTION_BITS - 1))) >> TILT_FRACTION_BITS;
+    // Take the queued presses in order, up to a second press of one button,
+    // which is left for the next read
+    int* pressed[4] = {&in.b1, &in.b2, &in.b3, &in.b4};
+    in.b1 = in.b2 = in.b3 = in.b4 = false;
+    while (events_out != events_in) {
+        ButtonEvent* ev = &button_events[events_out % BUTTON_EVENTS];
+        if (*pressed[ev->button])
+            break;
+        *pressed[ev->button] = true;
+        PROFILE_SAMPLE(PROF_PRESS, button_clock.read_us() - ev->us);
+        events_out++;
     }
-    b4Pressed = !button4;
+#if RECORD_INPUTS
+    record_inputs(&in);
+#endif
     return in;
 }
+
+void wait_for_press()
+{
+#if !REPLAY_INPUTS
+    while (events_out == events_in)
+        sleep();
+#endif
+}
+
+void log_state(unsigned int checksum)
+{
+#if RECORD_INPUTS
+    pc.printf("@S %08X\r\n", checksum);
+    state_count++;
+#elif REPLAY_INPUTS
+    char line[40];
+    unsigned int logged;
+    if (!next_record('S', line, sizeof(line)) || sscanf(line, "@S %x", &logged) != 1)
+        replay_done();
+    state_count++;
+    if (logged != checksum) {
+        if (!state_mismatches)
+            pc.printf("Replay: state differs from the log after input %u\r\n", input_count);
+        state_mismatches++;
+    }
+#endif
+}
+
+void log_inputs_done()
+{
+#if RECORD_INPUTS
+    pc.printf("Recorded %u inputs and %u states\r\n", input_count, state_count);
+    pc.printf("@E\r\n");
+#elif REPLAY_INPUTS
+    pc.printf("Replayed %u inputs: %u of %u states differ from the log\r\n",
+        input_count, state_mismatches, state_count);
+#endif
+}
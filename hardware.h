@@ -1,13 +1,19 @@
 #ifndef HARDWARE_H
 #define HARDWARE_H
 
+/**
+ * Accelerometer readings are in counts of the MMA8452's 12-bit samples over
+ * +-2 g, so the input path needs no floating point (the LPC1768 has no FPU).
+ */
+#define TILT_COUNTS_PER_G 1024
+
 /**
  * Structure that represents all the inputs to the game.
  * If additional hardware is added, new elements should be added to this struct.
  */
 struct GameInputs {
     int b1, b2, b3, b4;     // Button presses
-    double ax, ay, az;  // Accelerometer readings
+    int ax, ay, az;         // Accelerometer readings, TILT_COUNTS_PER_G to 1 g
 };
 
 /**
@@ -23,4 +29,22 @@ int hardware_init();
  */
 GameInputs read_inputs();
 
+/**
+ * Sleep until a button press is waiting for read_inputs. Returns at once if
+ * one already is, or when replaying inputs.
+ */
+void wait_for_press();
+
+/**
+ * With RECORD_INPUTS, log a checksum of the game state after an update. With
+ * REPLAY_INPUTS, check it against the one in the log. Does nothing otherwise.
+ */
+void log_state(unsigned int checksum);
+
+/**
+ * Print how many inputs were recorded or replayed, and how many state
+ * checksums did not match the log.
+ */
+void log_inputs_done();
+
 #endif // HARDWARE_H
\ No newline at end of file
@@ -80,17 +80,91 @@ Naming conventions in this file:
  * Use "HashTable" instead when you are creating a new variable. [See top comments]
  */
 struct _HashTable {
+    /** The engine of the hash table, HASH_CHAINED or HASH_OPEN */
+    int type;
+
     /** The array of pointers to the head of a singly linked list, whose nodes
-        are HashTableEntry objects */
+        are HashTableEntry objects (HASH_CHAINED only) */
     HashTableEntry** buckets;
 
     /** The hash function pointer */
     HashFunction hash;
 
-    /** The number of buckets in the hash table */
+    /** The number of buckets in the hash table. For HASH_OPEN this is the
+        number of slots, which is always a power of two */
     unsigned int num_buckets;
+
+    /** The number of entries stored in the hash table */
+    unsigned int num_entries;
+
+    /** While a HASH_CHAINED table is being resized, the bucket array that
+        entries are being moved out of, or NULL when no resize is in progress */
+    HashTableEntry** old_buckets;
+
+    /** The number of buckets in old_buckets */
+    unsigned int old_num_buckets;
+
+    /** Every bucket of old_buckets below this index has already been moved */
+    unsigned int rehash_index;
+
+    /** The keys, values and slot states of each slot (HASH_OPEN only) */
+    unsigned int* keys;
+    void** values;
+    unsigned char* states;
+
+    /** The number of DELETED slots (HASH_OPEN only) */
+    unsigned int num_tombstones;
+
+    /** The pool the HashTableEntry objects come from (HASH_CHAINED only) */
+    Pool* entry_pool;
+
+    /** The pool the values come from, or NULL if they come from malloc */
+    Pool* value_pool;
+
+    /** Values between shared_start and shared_end are shared with other
+        owners and are never freed by the table */
+    const char* shared_start;
+    const char* shared_end;
 };
 
+/**
+ * The number of HashTableEntry objects a HASH_CHAINED table takes from the
+ * heap at once.
+ */
+#define ENTRY_SLAB_SIZE 16
+
+/**
+ * A HASH_CHAINED table starts doubling its buckets once it holds more than
+ * this many sixteenths of an entry per bucket.
+ */
+#define CHAINED_MAX_LOAD_16THS 32
+
+/**
+ * The number of old buckets moved into the new bucket array on each insert
+ * while a HASH_CHAINED table is being resized. A resize is started when the
+ * load passes CHAINED_MAX_LOAD_16THS, so it always finishes long before the
+ * new bucket array gets that full.
+ */
+#define REHASH_STEP 4
+
+/**
+ * Slot states for HASH_OPEN tables. A DELETED slot (tombstone) keeps probe
+ * sequences that ran through a removed entry intact.
+ */
+#define SLOT_EMPTY   0
+#define SLOT_FULL    1
+#define SLOT_DELETED 2
+
+/**
+ * A HASH_OPEN table grows (or is rehashed in place if most of the used slots
+ * are tombstones) when FULL plus DELETED slots would exceed this many
+ * sixteenths of the slots.
+ */
+#define OPEN_MAX_LOAD_16THS 11
+
+/** The smallest number of slots in a HASH_OPEN table */
+#define OPEN_MIN_SLOTS 8
+
 /**
  * This structure represents a hash table entry.
  * Use "HashTableEntry" instead when you are creating a new variable. [See top comments]
@@ -120,16 +194,17 @@ struct _HashTableEntry {
 * createHashTableEntry
 *
 * Helper function that creates a hash table entry by allocating memory for it on
-* the heap. It initializes the entry with key and value, initialize pointer to
-* the next entry as NULL, and return the pointer to this hash table entry.
+* the table's entry pool. It initializes the entry with key and value, initialize
+* pointer to the next entry as NULL, and return the pointer to this hash table entry.
 *
+* @param hashTable The pointer to the hash table.
 * @param key The key corresponds to the hash table entry
 * @param value The value stored in the hash table entry
 * @return The pointer to the hash table entry
 */
-static HashTableEntry* createHashTableEntry(unsigned int key, void* value) {
-    // Allocate memory for the new HashTableEntry struct on heap
-    HashTableEntry* newEntry = (HashTableEntry*)malloc(sizeof(HashTableEntry));
+static HashTableEntry* createHashTableEntry(HashTable* hashTable, unsigned int key, void* value) {
+    // Allocate memory for the new HashTableEntry struct from the pool
+    HashTableEntry* newEntry = (HashTableEntry*)poolAlloc(hashTable->entry_pool);
     if (!newEntry)
         pc.printf("OUT OF MEMORY");
     
@@ -141,6 +216,124 @@ static HashTableEntry* createHashTableEntry(unsigned int key, void* value) {
     return newEntry;
 }
 
+/**
+* freeValue
+*
+* Helper function that frees a value stored in the hash table, returning it to
+* the value pool if the table has one. NULL and shared values are ignored.
+*
+* @param hashTable The pointer to the hash table.
+* @param value The value to free
+*/
+static void freeValue(HashTable* hashTable, void* value) {
+    if ((const char*)value >= hashTable->shared_start
+        && (const char*)value < hashTable->shared_end)
+        return;
+    if (hashTable->value_pool)
+        poolFree(hashTable->value_pool, value);
+    else
+        free(value);
+}
+
+/**
+* findBucket
+*
+* Helper function that returns the bucket (the head pointer of a singly linked
+* list) that a key belongs in. While the table is being resized, keys whose old
+* bucket has not been moved yet are still found in the old bucket array.
+*
+* @param hashTable The pointer to the hash table.
+* @param key The key corresponds to the hash table entry
+* @return The pointer to the head pointer of the bucket
+*/
+static HashTableEntry** findBucket(HashTable* hashTable, unsigned int key) {
+    // Get hash for the key
+    unsigned int hash = hashTable->hash(key);
+    if (hashTable->old_buckets) {
+        unsigned int oldIndex = hash % hashTable->old_num_buckets;
+        if (oldIndex >= hashTable->rehash_index) {
+            return &hashTable->old_buckets[oldIndex];
+        }
+    }
+    return &hashTable->buckets[hash % hashTable->num_buckets];
+}
+
+/**
+* rehashStep
+*
+* Helper function that moves up to REHASH_STEP buckets of a resizing table from
+* the old bucket array into the new one, and frees the old array once it is
+* empty. Does nothing if no resize is in progress.
+*
+* @param hashTable The pointer to the hash table.
+*/
+static void rehashStep(HashTable* hashTable) {
+    if (!hashTable->old_buckets) {
+        return;
+    }
+
+    unsigned int i;
+    HashTableEntry* curr;
+    HashTableEntry* next;
+    HashTableEntry** bucket;
+    for (i = 0; i < REHASH_STEP && hashTable->rehash_index < hashTable->old_num_buckets; i++) {
+        // Move every entry in the next old bucket to the head of its new bucket
+        curr = hashTable->old_buckets[hashTable->rehash_index];
+        hashTable->old_buckets[hashTable->rehash_index] = NULL;
+        hashTable->rehash_index++;
+        while (curr) {
+            next = curr->next;
+            bucket = &hashTable->buckets[hashTable->hash(curr->key) % hashTable->num_buckets];
+            curr->next = *bucket;
+            *bucket = curr;
+            curr = next;
+        }
+    }
+
+    // All old buckets are moved, so the resize is finished
+    if (hashTable->rehash_index == hashTable->old_num_buckets) {
+        free(hashTable->old_buckets);
+        hashTable->old_buckets = NULL;
+        hashTable->old_num_buckets = 0;
+        hashTable->rehash_index = 0;
+    }
+}
+
+/**
+* startResize
+*
+* Helper function that starts doubling the buckets of a HASH_CHAINED table once
+* its load factor passes CHAINED_MAX_LOAD_16THS. Only the new bucket array is
+* allocated here; the entries are moved over a few buckets at a time by
+* rehashStep, so no single insert has to move the whole table.
+*
+* @param hashTable The pointer to the hash table.
+*/
+static void startResize(HashTable* hashTable) {
+    if (hashTable->old_buckets
+        || hashTable->num_entries * 16 <= hashTable->num_buckets * CHAINED_MAX_LOAD_16THS) {
+        return;
+    }
+
+    unsigned int numBuckets = hashTable->num_buckets * 2;
+    HashTableEntry** buckets = (HashTableEntry**)malloc(numBuckets*sizeof(HashTableEntry*));
+    if (!buckets) {
+        // Not fatal, the table just keeps its current buckets for now
+        pc.printf("OUT OF MEMORY");
+        return;
+    }
+    unsigned int i;
+    for (i = 0; i < numBuckets; i++) {
+        buckets[i] = NULL;
+    }
+
+    hashTable->old_buckets = hashTable->buckets;
+    hashTable->old_num_buckets = hashTable->num_buckets;
+    hashTable->rehash_index = 0;
+    hashTable->buckets = buckets;
+    hashTable->num_buckets = numBuckets;
+}
+
 /**
 * findItem
 *
@@ -152,10 +345,8 @@ static HashTableEntry* createHashTableEntry(unsigned int key, void* value) {
 * @return The pointer to the hash table entry, or NULL if key does not exist
 */
 static HashTableEntry* findItem(HashTable* hashTable, unsigned int key) {
-    // Get hash for the key
-    unsigned int hash = hashTable->hash(key);
     // Get pointer to the head
-    HashTableEntry* curr = hashTable->buckets[hash];
+    HashTableEntry* curr = *findBucket(hashTable, key);
     // While pointer is not NULL
     while (curr) {
         // If the key is found
@@ -182,10 +373,8 @@ static HashTableEntry* findItem(HashTable* hashTable, unsigned int key) {
 * @return The pointer to the previous entry, or NULL if key does not exist
 */
 static HashTableEntry* findPrevious(HashTable* hashTable, unsigned int key) {
-    // Get hash for the key
-    unsigned int hash = hashTable->hash(key);
     // Get pointer to the head
-    HashTableEntry* curr = hashTable->buckets[hash];
+    HashTableEntry* curr = *findBucket(hashTable, key);
     // While current and next entries are not NULL
     while (curr && curr->next) {
         // If next entry has desired key
@@ -197,6 +386,156 @@ static HashTableEntry* findPrevious(HashTable* hashTable, unsigned int key) {
     return NULL;
 }
 
+/**
+* openSlot
+*
+* Helper function that returns the first slot to probe for a key in a HASH_OPEN
+* table. The output of the hash function is spread over all the slots with
+* Fibonacci hashing, so hash functions should not fold keys into a small range
+* for these tables (the identity function works well for map keys).
+*
+* @param hashTable The pointer to the hash table.
+* @param key The key to look for
+* @return The index of the first slot in the probe sequence of the key
+*/
+static unsigned int openSlot(HashTable* hashTable, unsigned int key) {
+    return (hashTable->hash(key) * 2654435761u) & (hashTable->num_buckets - 1);
+}
+
+/**
+* openFind
+*
+* Helper function that linearly probes a HASH_OPEN table for a key.
+*
+* @param hashTable The pointer to the hash table.
+* @param key The key to look for
+* @return The index of the FULL slot holding the key, or -1 if the key does not exist
+*/
+static int openFind(HashTable* hashTable, unsigned int key) {
+    unsigned int mask = hashTable->num_buckets - 1;
+    unsigned int i = openSlot(hashTable, key);
+    // An EMPTY slot ends every probe sequence, and there is always at least one
+    while (hashTable->states[i] != SLOT_EMPTY) {
+        if (hashTable->states[i] == SLOT_FULL && hashTable->keys[i] == key) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+/**
+* openAllocate
+*
+* Helper function that allocates empty slot arrays for a HASH_OPEN table.
+*
+* @param hashTable The pointer to the hash table.
+* @param numSlots The number of slots, a power of two
+*/
+static void openAllocate(HashTable* hashTable, unsigned int numSlots) {
+    hashTable->num_buckets = numSlots;
+    hashTable->num_entries = 0;
+    hashTable->num_tombstones = 0;
+    hashTable->keys = (unsigned int*)malloc(numSlots*sizeof(unsigned int));
+    hashTable->values = (void**)malloc(numSlots*sizeof(void*));
+    hashTable->states = (unsigned char*)calloc(numSlots, sizeof(unsigned char));
+    if (!hashTable->keys || !hashTable->values || !hashTable->states)
+        pc.printf("OUT OF MEMORY");
+}
+
+/**
+* openResize
+*
+* Helper function that moves every entry of a HASH_OPEN table into freshly
+* allocated slot arrays, dropping all tombstones along the way.
+*
+* @param hashTable The pointer to the hash table.
+* @param numSlots The new number of slots, a power of two
+*/
+static void openResize(HashTable* hashTable, unsigned int numSlots) {
+    unsigned int oldSlots = hashTable->num_buckets;
+    unsigned int* oldKeys = hashTable->keys;
+    void** oldValues = hashTable->values;
+    unsigned char* oldStates = hashTable->states;
+
+    openAllocate(hashTable, numSlots);
+    unsigned int mask = numSlots - 1;
+    unsigned int i, j;
+    for (i = 0; i < oldSlots; i++) {
+        if (oldStates[i] != SLOT_FULL)
+            continue;
+        // Keys are unique, so just take the first EMPTY slot in the sequence
+        j = openSlot(hashTable, oldKeys[i]);
+        while (hashTable->states[j] != SLOT_EMPTY)
+            j = (j + 1) & mask;
+        hashTable->keys[j] = oldKeys[i];
+        hashTable->values[j] = oldValues[i];
+        hashTable->states[j] = SLOT_FULL;
+        hashTable->num_entries++;
+    }
+    free(oldKeys);
+    free(oldValues);
+    free(oldStates);
+}
+
+/**
+* openInsert
+*
+* Insert or replace a value in a HASH_OPEN table. See insertItem.
+*/
+static void* openInsert(HashTable* hashTable, unsigned int key, void* value) {
+    int found = openFind(hashTable, key);
+    // Key already exists. Replace value and return old value
+    if (found >= 0) {
+        void* oldValue = hashTable->values[found];
+        hashTable->values[found] = value;
+        return oldValue;
+    }
+
+    // Make room first if the new entry would push the table past its load factor
+    unsigned int used = hashTable->num_entries + hashTable->num_tombstones + 1;
+    if (used * 16 > hashTable->num_buckets * OPEN_MAX_LOAD_16THS) {
+        unsigned int numSlots = hashTable->num_buckets;
+        // Only grow if most of the load is live entries, not tombstones
+        if (hashTable->num_entries >= hashTable->num_tombstones)
+            numSlots *= 2;
+        openResize(hashTable, numSlots);
+    }
+
+    // Reuse the first tombstone in the probe sequence, or else the EMPTY slot
+    unsigned int mask = hashTable->num_buckets - 1;
+    unsigned int i = openSlot(hashTable, key);
+    while (hashTable->states[i] == SLOT_FULL)
+        i = (i + 1) & mask;
+    if (hashTable->states[i] == SLOT_DELETED)
+        hashTable->num_tombstones--;
+    hashTable->keys[i] = key;
+    hashTable->values[i] = value;
+    hashTable->states[i] = SLOT_FULL;
+    hashTable->num_entries++;
+    return NULL;
+}
+
+/**
+* openRemove
+*
+* Remove an entry from a HASH_OPEN table, leaving a tombstone in its slot.
+*
+* @param hashTable The pointer to the hash table.
+* @param key The key of the entry to remove
+* @return The value stored under the key, or NULL if the key does not exist
+*/
+static void* openRemove(HashTable* hashTable, unsigned int key) {
+    int found = openFind(hashTable, key);
+    if (found < 0) {
+        return NULL;
+    }
+    hashTable->states[found] = SLOT_DELETED;
+    hashTable->num_entries--;
+    hashTable->num_tombstones++;
+    return hashTable->values[found];
+}
+
 /****************************************************************************
 * Public Interface Functions
 *
@@ -206,6 +545,10 @@ static HashTableEntry* findPrevious(HashTable* hashTable, unsigned int key) {
 ****************************************************************************/
 // The createHashTable is provided for you as a starting point.
 HashTable* createHashTable(HashFunction hashFunction, unsigned int numBuckets) {
+    return createHashTableOfType(hashFunction, numBuckets, HASH_CHAINED);
+}
+
+HashTable* createHashTableOfType(HashFunction hashFunction, unsigned int numBuckets, int type) {
     // The hash table has to contain at least one bucket. Exit gracefully if
     // this condition is not met.
     if (numBuckets==0) {
@@ -219,11 +562,36 @@ HashTable* createHashTable(HashFunction hashFunction, unsigned int numBuckets) {
         pc.printf("OUT OF MEMORY");
 
     // Initialize the components of the new HashTable struct.
+    newTable->type = type;
     newTable->hash = hashFunction;
+    newTable->old_buckets = NULL;
+    newTable->old_num_buckets = 0;
+    newTable->rehash_index = 0;
+    newTable->keys = NULL;
+    newTable->values = NULL;
+    newTable->states = NULL;
+    newTable->num_entries = 0;
+    newTable->num_tombstones = 0;
+    newTable->entry_pool = NULL;
+    newTable->value_pool = NULL;
+    newTable->shared_start = NULL;
+    newTable->shared_end = NULL;
+
+    // Open addressing tables need a power of two number of slots
+    if (type == HASH_OPEN) {
+        unsigned int numSlots = OPEN_MIN_SLOTS;
+        while (numSlots < numBuckets)
+            numSlots *= 2;
+        newTable->buckets = NULL;
+        openAllocate(newTable, numSlots);
+        return newTable;
+    }
+
     newTable->num_buckets = numBuckets;
     newTable->buckets = (HashTableEntry**)malloc(numBuckets*sizeof(HashTableEntry*));
     if (!newTable->buckets)
         pc.printf("OUT OF MEMORY");
+    newTable->entry_pool = createPool(sizeof(HashTableEntry), ENTRY_SLAB_SIZE);
 
     // As the new buckets contain indeterminant values, init each bucket as NULL.
     unsigned int i;
@@ -238,30 +606,60 @@ HashTable* createHashTable(HashFunction hashFunction, unsigned int numBuckets) {
 void destroyHashTable(HashTable* hashTable) {
     unsigned int i;
     HashTableEntry* curr;
-    HashTableEntry* next;
-    // For every bucket
-    for (i = 0; i < hashTable->num_buckets; i++) {
-        // Get head pointer in bucket
-        curr = hashTable->buckets[i];
-        // While the HashTableEntry pointer is not NULL
-        while (curr) {
-            // Free the value from the heap
-            free(curr->value);
-            // Get pointer to next entry
-            next = curr->next;
-            // Free the entry from the heap
-            free(curr);
-            // Move current pointer to next entry
-            curr = next;
+
+    if (hashTable->type == HASH_OPEN) {
+        // Free the values of all live slots, then the slot arrays. Values from
+        // a pool are all freed at once by resetting it.
+        if (hashTable->value_pool) {
+            poolReset(hashTable->value_pool);
+        } else {
+            for (i = 0; i < hashTable->num_buckets; i++) {
+                if (hashTable->states[i] == SLOT_FULL)
+                    freeValue(hashTable, hashTable->values[i]);
+            }
+        }
+        free(hashTable->keys);
+        free(hashTable->values);
+        free(hashTable->states);
+        free(hashTable);
+        return;
+    }
+
+    // Values from a pool are all freed at once by resetting it. Otherwise
+    // every value has to be found and freed on its own.
+    if (hashTable->value_pool) {
+        poolReset(hashTable->value_pool);
+    } else {
+        // Finish any resize in progress so every entry is in the new buckets
+        while (hashTable->old_buckets) {
+            rehashStep(hashTable);
+        }
+        // For every bucket
+        for (i = 0; i < hashTable->num_buckets; i++) {
+            // Get head pointer in bucket
+            curr = hashTable->buckets[i];
+            // While the HashTableEntry pointer is not NULL
+            while (curr) {
+                // Free the value from the heap
+                freeValue(hashTable, curr->value);
+                // Move current pointer to next entry
+                curr = curr->next;
+            }
         }
     }
-    // Free the HashTableEntry** buckets array from the heap
+    // Free every HashTableEntry at once with their pool
+    destroyPool(hashTable->entry_pool);
+    // Free the HashTableEntry** buckets arrays from the heap
+    free(hashTable->old_buckets);
     free(hashTable->buckets);
     // Free the HashTable from the heap
     free(hashTable);
 }
 
 void* insertItem(HashTable* hashTable, unsigned int key, void* value) {
+    if (hashTable->type == HASH_OPEN)
+        return openInsert(hashTable, key, value);
+
     // Find the HashTableEntry if it already exists in HashTable
     HashTableEntry* entry = findItem(hashTable, key);
     // HashTableEntry already exists. Replace value and return old value
@@ -271,19 +669,30 @@ void* insertItem(HashTable* hashTable, unsigned int key, void* value) {
         return oldValue;
     }
 
+    // Move part of the table if it is being resized, or start a resize if
+    // this insert pushes it past its load factor
+    rehashStep(hashTable);
+    hashTable->num_entries++;
+    startResize(hashTable);
+
     // Create new HashTableEntry from key and value
-    entry = createHashTableEntry(key, value);
-    // Get hash for the key
-    unsigned int hash = hashTable->hash(key);
+    entry = createHashTableEntry(hashTable, key, value);
+    // Get the bucket for the key
+    HashTableEntry** bucket = findBucket(hashTable, key);
     // Set next pointer of new entry to old head
-    entry->next = hashTable->buckets[hash];
+    entry->next = *bucket;
     // Set head to new entry
-    hashTable->buckets[hash] = entry;
+    *bucket = entry;
 
     return NULL;
 }
 
 void* getItem(HashTable* hashTable, unsigned int key) {
+    if (hashTable->type == HASH_OPEN) {
+        int found = openFind(hashTable, key);
+        return found >= 0 ? hashTable->values[found] : NULL;
+    }
+
     // Find the HashTableEntry if it exists in HashTable
     HashTableEntry* entry = findItem(hashTable, key);
     // HashTableEntry was not found
@@ -296,10 +705,13 @@ void* getItem(HashTable* hashTable, unsigned int key) {
 }
 
 void* removeItem(HashTable* hashTable, unsigned int key) {
-    // Get hash for the key
-    unsigned int hash = hashTable->hash(key);
+    if (hashTable->type == HASH_OPEN)
+        return openRemove(hashTable, key);
+
+    // Get the bucket for the key
+    HashTableEntry** bucket = findBucket(hashTable, key);
     // Get head entry at the relevant bucket
-    HashTableEntry* entry = hashTable->buckets[hash];
+    HashTableEntry* entry = *bucket;
 
     // The key is not present
     if (!entry) {
@@ -309,7 +721,7 @@ void* removeItem(HashTable* hashTable, unsigned int key) {
     // If the entry with the desired key is at the head
     if (entry->key == key) {
         // Set head to next entry
-        hashTable->buckets[hash] = entry->next;
+        *bucket = entry->next;
     } else {
         // Find the previous entry
         HashTableEntry* prevEntry = findPrevious(hashTable, key);
@@ -324,18 +736,25 @@ void* removeItem(HashTable* hashTable, unsigned int key) {
         prevEntry->next = entry->next;
     }
 
+    hashTable->num_entries--;
     // Get value stored in the entry
     void* value = entry->value;
-    // Free HashTableEntry from heap
-    free(entry);
+    // Return HashTableEntry to the pool
+    poolFree(hashTable->entry_pool, entry);
     return value;
 }
 
 void deleteItem(HashTable* hashTable, unsigned int key) {
-    // Get hash for the key
-    unsigned int hash = hashTable->hash(key);
+    if (hashTable->type == HASH_OPEN) {
+        // Free value (NULL is ignored if the key was not present)
+        freeValue(hashTable, openRemove(hashTable, key));
+        return;
+    }
+
+    // Get the bucket for the key
+    HashTableEntry** bucket = findBucket(hashTable, key);
     // Get head entry at the relevant bucket
-    HashTableEntry* entry = hashTable->buckets[hash];
+    HashTableEntry* entry = *bucket;
 
     // The key is not present
     if (!entry) {
@@ -345,7 +764,7 @@ void deleteItem(HashTable* hashTable, unsigned int key) {
     // If the entry with the desired key is at the head
     if (entry->key == key) {
         // Set head to next entry
-        hashTable->buckets[hash] = entry->next;
+        *bucket = entry->next;
     } else {
         // Find the previous entry
         HashTableEntry* prevEntry = findPrevious(hashTable, key);
@@ -360,8 +779,111 @@ void deleteItem(HashTable* hashTable, unsigned int key) {
         prevEntry->next = entry->next;
     }
 
-    // Free value from heap
-    free(entry->value);
-    // Free HashTableEntry from heap
-    free(entry);
+    hashTable->num_entries--;
+    // Free value
+    freeValue(hashTable, entry->value);
+    // Return HashTableEntry to the pool
+    poolFree(hashTable->entry_pool, entry);
+}
+
+unsigned int hashTableFootprint(unsigned int numBuckets, unsigned int numEntries) {
+    return sizeof(HashTable)
+         + numBuckets * sizeof(HashTableEntry*)
+         + numEntries * sizeof(HashTableEntry);
+}
+
+unsigned int getHashTableBytes(HashTable* hashTable) {
+    if (hashTable->type == HASH_OPEN) {
+        return sizeof(HashTable) + hashTable->num_buckets
+             * (sizeof(unsigned int) + sizeof(void*) + sizeof(unsigned char));
+    }
+
+    PoolStats stats;
+    getPoolStats(hashTable->entry_pool, &stats);
+    return sizeof(HashTable) + stats.slab_bytes
+         + (hashTable->num_buckets + hashTable->old_num_buckets) * sizeof(HashTableEntry*);
+}
+
+void setHashTableValuePool(HashTable* hashTable, Pool* pool) {
+    hashTable->value_pool = pool;
+}
+
+void setHashTableSharedValues(HashTable* hashTable, const void* start, unsigned int size) {
+    hashTable->shared_start = (const char*)start;
+    hashTable->shared_end = (const char*)start + size;
+}
+
+void getHashTablePoolStats(HashTable* hashTable, PoolStats* stats) {
+    if (hashTable->entry_pool) {
+        getPoolStats(hashTable->entry_pool, stats);
+        return;
+    }
+    // HASH_OPEN tables keep their entries in the slot arrays
+    stats->block_size = 0;
+    stats->live = 0;
+    stats->high_water = 0;
+    stats->slab_bytes = 0;
+    stats->bytes_saved = 0;
+}
+
+/**
+* addChainStats
+*
+* Helper function that adds the chains of a bucket array to the statistics.
+*
+* @param stats The statistics to update
+* @param buckets The bucket array
+* @param first The index of the first bucket to include
+* @param numBuckets The number of buckets in the array
+*/
+static void addChainStats(HashTableStats* stats, HashTableEntry** buckets,
+                          unsigned int first, unsigned int numBuckets) {
+    unsigned int i, length;
+    HashTableEntry* curr;
+    for (i = first; i < numBuckets; i++) {
+        length = 0;
+        for (curr = buckets[i]; curr; curr = curr->next) {
+            // Finding the n-th entry in a chain takes n probes
+            length++;
+            stats->total_probes += length;
+        }
+        if (length > stats->longest_chain)
+            stats->longest_chain = length;
+        stats->histogram[length < HASH_STATS_BINS ? length : HASH_STATS_BINS - 1]++;
+    }
+}
+
+void getHashTableStats(HashTable* hashTable, HashTableStats* stats) {
+    unsigned int i, j;
+    stats->num_entries = hashTable->num_entries;
+    stats->num_buckets = hashTable->num_buckets;
+    stats->longest_chain = 0;
+    stats->total_probes = 0;
+    stats->resizing = hashTable->old_buckets != NULL;
+    for (i = 0; i < HASH_STATS_BINS; i++) {
+        stats->histogram[i] = 0;
+    }
+
+    if (hashTable->type == HASH_OPEN) {
+        // The "chain" of an entry is the run of slots probed to reach it
+        unsigned int mask = hashTable->num_buckets - 1;
+        unsigned int length;
+        for (i = 0; i < hashTable->num_buckets; i++) {
+            if (hashTable->states[i] != SLOT_FULL)
+                continue;
+            j = openSlot(hashTable, hashTable->keys[i]);
+            length = ((i - j) & mask) + 1;
+            stats->total_probes += length;
+            if (length > stats->longest_chain)
+                stats->longest_chain = length;
+            stats->histogram[length < HASH_STATS_BINS ? length : HASH_STATS_BINS - 1]++;
+        }
+        return;
+    }
+
+    addChainStats(stats, hashTable->buckets, 0, hashTable->num_buckets);
+    if (hashTable->old_buckets) {
+        addChainStats(stats, hashTable->old_buckets, hashTable->rehash_index,
+                      hashTable->old_num_buckets);
+    }
 }
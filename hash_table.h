@@ -10,6 +10,8 @@
 #ifndef HASHTABLE_H
 #define HASHTABLE_H
 
+#include "pool.h"
+
 /****************************************************************************
  * Forward Declarations
  *
@@ -47,6 +49,22 @@ typedef struct _HashTable HashTable;
  */
 typedef struct _HashTableEntry HashTableEntry;
 
+/**
+ * Hash table engines, chosen when the table is created.
+ *
+ * HASH_CHAINED keeps one singly linked list of heap allocated HashTableEntry
+ * objects per bucket. The hash function output is taken modulo the number of
+ * buckets, and the buckets are doubled a few at a time once the table holds
+ * more than two entries per bucket.
+ *
+ * HASH_OPEN keeps keys and values in contiguous arrays and resolves collisions
+ * with linear probing. Removed entries leave tombstones, and the arrays are
+ * reallocated when the load factor gets too high. The hash function output is
+ * mixed over all the slots, so it should not fold keys into a small range.
+ */
+#define HASH_CHAINED 0
+#define HASH_OPEN    1
+
 /**
  * createHashTable
  *
@@ -61,6 +79,43 @@ typedef struct _HashTableEntry HashTableEntry;
  */
 HashTable* createHashTable(HashFunction myHashFunc, unsigned int numBuckets);
 
+/**
+ * createHashTableOfType
+ *
+ * Creates a hash table that uses the given engine. createHashTable is the same
+ * as calling this with HASH_CHAINED. For HASH_OPEN, numBuckets is the initial
+ * number of slots, rounded up to a power of two; the table grows as needed.
+ *
+ * @param myHashFunc The pointer to the custom hash function.
+ * @param numBuckets The number of buckets available in the hash table.
+ * @param type HASH_CHAINED or HASH_OPEN
+ * @return a pointer to the new hash table
+ */
+HashTable* createHashTableOfType(HashFunction myHashFunc, unsigned int numBuckets, int type);
+
+/**
+ * The number of chain (or probe) lengths counted separately by HashTableStats.
+ * Longer chains are counted in the last bin.
+ */
+#define HASH_STATS_BINS 8
+
+/**
+ * Load statistics of a hash table, filled in by getHashTableStats.
+ *
+ * For HASH_CHAINED a chain is the list in one bucket, and histogram[n] is the
+ * number of buckets holding n entries. For HASH_OPEN a chain is the run of
+ * slots probed to find an entry, and histogram[n] is the number of entries
+ * found after n probes.
+ */
+typedef struct {
+    unsigned int num_entries;   // Entries stored in the table
+    unsigned int num_buckets;   // Buckets (or slots) in the table
+    unsigned int longest_chain; // Longest chain in the table
+    unsigned int total_probes;  // Probes needed to look up every entry once
+    int resizing;               // True while a HASH_CHAINED resize is in progress
+    unsigned int histogram[HASH_STATS_BINS];
+} HashTableStats;
+
 /**
  * destroyHashTable
  *
@@ -124,4 +179,76 @@ void* removeItem(HashTable* myHashTable, unsigned int key);
  */
 void deleteItem(HashTable* myHashTable, unsigned int key);
 
+/**
+ * hashTableFootprint
+ *
+ * Compute the number of heap bytes used by a HASH_CHAINED table with the given number
+ * of buckets and entries. This counts the table, its bucket array and its
+ * entries, but not the values stored in the entries.
+ *
+ * @param numBuckets The number of buckets in the hash table.
+ * @param numEntries The number of entries stored in the hash table.
+ * @return the heap bytes used by the hash table
+ */
+unsigned int hashTableFootprint(unsigned int numBuckets, unsigned int numEntries);
+
+/**
+ * getHashTableBytes
+ *
+ * Compute the number of heap bytes currently used by a hash table of either
+ * engine, not counting the values stored in it.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @return the heap bytes used by the hash table
+ */
+unsigned int getHashTableBytes(HashTable* myHashTable);
+
+/**
+ * getHashTableStats
+ *
+ * Compute the load statistics of a hash table. This walks the whole table, so
+ * it is meant for diagnostics rather than the game loop.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @param stats The statistics to fill in.
+ */
+void getHashTableStats(HashTable* myHashTable, HashTableStats* stats);
+
+/**
+ * setHashTableValuePool
+ *
+ * Tell the hash table that its values are allocated from pool. The table then
+ * returns values to the pool instead of calling free, and destroyHashTable
+ * frees all of them with a single poolReset instead of walking every entry.
+ * Everything else allocated from the pool is freed by that reset as well.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @param pool The pool the values come from, or NULL for malloc.
+ */
+void setHashTableValuePool(HashTable* myHashTable, Pool* pool);
+
+/**
+ * setHashTableSharedValues
+ *
+ * Tell the hash table that values inside the given memory range are shared
+ * (e.g. flyweight prototypes referenced by many entries). The table still
+ * stores and returns them, but deleteItem and destroyHashTable never free them.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @param start The first byte of the shared range.
+ * @param size The size of the shared range, in bytes.
+ */
+void setHashTableSharedValues(HashTable* myHashTable, const void* start, unsigned int size);
+
+/**
+ * getHashTablePoolStats
+ *
+ * Read the counters of the pool a HASH_CHAINED table allocates its entries
+ * from. HASH_OPEN tables have no entry pool and report all zeros.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @param stats The counters to fill in.
+ */
+void getHashTablePoolStats(HashTable* myHashTable, PoolStats* stats);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+// ============================================
+// Host stand-in for the MMA8452 accelerometer: reads what the input script
+// sets, and lies flat otherwise. Once its data-ready interrupt is enabled it
+// pulls INT1, wired to p29 as on the board (see hardware.cpp), low at the
+// data rate until each sample is read.
+//=============================================
+#ifndef HOST_MMA8452_H
+#define HOST_MMA8452_H
+
+#include "mbed.h"
+
+class MMA8452 {
+public:
+    enum DataRateHz {
+        RATE_800 = 0x00, RATE_400, RATE_200, RATE_100, RATE_50, RATE_12_5,
+        RATE_6_25, RATE_1_563, RATE_UNKNOWN
+    };
+
+    MMA8452(PinName sda, PinName scl, int frequency) : _rate(RATE_800) {}
+    int setDataRate(DataRateHz dataRate, int toggleActivation = 1) {
+        _rate = dataRate;
+        return 0;
+    }
+    int enableDataReadyInterrupt(int int1 = 1, int toggleActivation = 1) {
+        host_accel_ready(int1 ? p29 : NC, 1250000LL << _rate);  // 800 Hz halved per step
+        return 0;
+    }
+    /** 12-bit counts over +-2 g, as the driver sets up by default */
+    int readXYZCounts(int *x, int *y, int *z) {
+        double g[3];
+        host_accel(&g[0], &g[1], &g[2]);
+        int *counts[3] = {x, y, z};
+        for (int i = 0; i < 3; i++) {
+            int c = (int)floor(g[i] * 1024 + 0.5);
+            *counts[i] = c < -2048 ? -2048 : c > 2047 ? 2047 : c;
+        }
+        host_accel_sampled();
+        return 0;
+    }
+    int readXYZGravity(double *x, double *y, double *z) {
+        host_accel(x, y, z);
+        host_accel_sampled();
+        return 0;
+    }
+
+private:
+    DataRateHz _rate;
+};
+
+#endif // HOST_MMA8452_H
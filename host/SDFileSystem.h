@@ -0,0 +1,14 @@
+// ============================================
+// Host stand-in for the SD card, which the game does not use.
+//=============================================
+#ifndef HOST_SDFILESYSTEM_H
+#define HOST_SDFILESYSTEM_H
+
+#include "mbed.h"
+
+class SDFileSystem {
+public:
+    SDFileSystem(PinName mosi, PinName miso, PinName sclk, PinName cs, const char *name) {}
+};
+
+#endif // HOST_SDFILESYSTEM_H
@@ -0,0 +1,518 @@
+// ============================================
+// The host build's simulated board: a virtual clock, the UARTs and their
+// interrupts, Timeouts, pin interrupts, and the emulated LCD on p9/p10.
+//
+// Nothing runs concurrently. Virtual time only moves when the program
+// waits (wait, wait_ms, sleep, a blocking putc or getc, or enabling
+// interrupts), and while it moves, bytes cross the serial lines at the
+// configured baud and any interrupts that fall due are delivered.
+//
+// Nothing else varies between runs either, so a run with the same input
+// script draws the same frames and sends the same bytes every time.
+//
+// Environment:
+//   HOST_INPUT   input script to play (see loadScript); its "end" line
+//                stops the run
+//   HOST_RUN_MS  stop after this much virtual time (default: never)
+//   LCD_DUMP     write the screen to LCD_DUMP<ms>.ppm every LCD_DUMP_MS
+//                milliseconds (default 1000) and on exit
+//=============================================
+#include "mbed.h"
+#include "lcd_emulator.h"
+
+#define HOST_UART_FIFO 16       // LPC1768 UART FIFOs
+#define HOST_IRQ_NS    1000     // cost of re-enabling interrupts
+#define HOST_TIMEOUTS  16
+#define HOST_PINS      32
+#define HOST_PIN_IRQS  8
+
+// One line of the input script: at a time, set a pin or an accelerometer
+// axis, or end the run
+struct HostInput {
+    long long at;
+    int pin;                        // -1: an axis
+    int axis;                       // 0-2: x, y, z; -1: end
+    double value;
+};
+
+struct HostUart {
+    int baud;
+    int is_lcd, is_console;
+
+    // Transmit FIFO, then the shift register on the line
+    unsigned char tx_fifo[HOST_UART_FIFO];
+    int           tx_head, tx_count;
+    int           shifting;
+    unsigned char shift;
+    long long     shift_done;
+    int           thre_pending;     // the FIFO ran empty
+    unsigned int  sent;
+
+    // Receive FIFO
+    unsigned char rx_fifo[HOST_UART_FIFO];
+    int           rx_head, rx_count;
+    unsigned int  overruns;
+
+    FunctionPointer irq[2];
+};
+
+struct Host {
+    long long now;
+    int irq_disabled, in_isr;
+    HostUart console, lcd_uart, other;
+    LcdEmulator lcd;
+    Timeout *timeouts[HOST_TIMEOUTS];
+    InterruptIn *pin_irqs[HOST_PIN_IRQS];
+    unsigned int handled;           // interrupt handlers called so far
+
+    HostInput *inputs;
+    int input_count, input_next;
+    int pins[HOST_PINS];
+    double accel[3];
+    int accel_pin;                  // data-ready line, or -1
+    long long accel_period, accel_next;
+
+    long long run_until;
+    const char *dump_prefix;
+    long long dump_every, next_dump;
+};
+
+static void report();
+static void loadScript(Host &h, const char *path);
+
+static Host &host()
+{
+    // Created on first use, since global mbed objects are constructed (and
+    // start using the board) before main
+    static Host *h = 0;
+    if (!h) {
+        h = new Host();             // zeroed
+        h->console.baud = h->lcd_uart.baud = h->other.baud = 9600;
+        h->console.is_console = 1;
+        h->lcd_uart.is_lcd = 1;
+        for (int i = 0; i < HOST_PINS; i++) h->pins[i] = 1;
+        h->accel[2] = 1;
+        h->accel_pin = -1;
+        if (getenv("HOST_INPUT")) loadScript(*h, getenv("HOST_INPUT"));
+        const char *run_ms = getenv("HOST_RUN_MS");
+        h->run_until = run_ms ? atoll(run_ms) * 1000000LL : -1;
+        h->dump_prefix = getenv("LCD_DUMP");
+        const char *dump_ms = getenv("LCD_DUMP_MS");
+        h->dump_every = (dump_ms ? atoll(dump_ms) : 1000) * 1000000LL;
+        h->next_dump = h->dump_every;
+        atexit(report);
+    }
+    return *h;
+}
+
+// The input script has one change per line, at a time in virtual ms from
+// reset, in order:
+//   <ms> p<N> <0|1>        hold pin N low or high (a pressed button is 0)
+//   <ms> ax|ay|az <g>      tilt the accelerometer
+//   <ms> end               stop the run
+// Anything after a # is a comment.
+static void loadScript(Host &h, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "host: cannot open input script %s\n", path);
+        exit(1);
+    }
+    char line[256];
+    int n = 0, capacity = 0;
+    long long last = 0;
+    while (fgets(line, sizeof(line), f)) {
+        n++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = 0;
+        double ms, value = 0;
+        char name[16];
+        int fields = sscanf(line, "%lf %15s %lf", &ms, name, &value);
+        if (fields <= 0) continue;
+        HostInput in;
+        in.at = (long long)(ms * 1000000);
+        in.pin = in.axis = -1;
+        in.value = value;
+        if (fields == 2 && !strcmp(name, "end")) {
+            // ends the run
+        } else if (fields == 3 && name[0] == 'p' && atoi(name + 1) > 0 && atoi(name + 1) < HOST_PINS) {
+            in.pin = atoi(name + 1);
+        } else if (fields == 3 && name[0] == 'a' && name[1] >= 'x' && name[1] <= 'z' && !name[2]) {
+            in.axis = name[1] - 'x';
+        } else {
+            fprintf(stderr, "host: %s:%d: expected <ms> p<N>|ax|ay|az <value>, or <ms> end\n", path, n);
+            exit(1);
+        }
+        if (in.at < last) {
+            fprintf(stderr, "host: %s:%d: time goes backwards\n", path, n);
+            exit(1);
+        }
+        last = in.at;
+        if (h.input_count == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            h.inputs = (HostInput *)realloc(h.inputs, capacity * sizeof(HostInput));
+        }
+        h.inputs[h.input_count++] = in;
+    }
+    fclose(f);
+}
+
+// Apply the script lines that are due
+static void playScript(Host &h)
+{
+    while (h.input_next < h.input_count && h.inputs[h.input_next].at <= h.now) {
+        HostInput &in = h.inputs[h.input_next++];
+        if (in.pin >= 0)
+            h.pins[in.pin] = in.value != 0;
+        else if (in.axis >= 0)
+            h.accel[in.axis] = in.value;
+        else
+            exit(0);
+    }
+}
+
+// Pull the accelerometer's data-ready line low when a sample is due
+static void sampleAccel(Host &h)
+{
+    if (h.accel_pin < 0 || h.now < h.accel_next)
+        return;
+    h.pins[h.accel_pin] = 0;
+    while (h.accel_next <= h.now) h.accel_next += h.accel_period;
+}
+
+static long long byteTime(const HostUart &u)
+{
+    return 10000000000LL / u.baud;      // start, 8 data and stop bits
+}
+
+static void dumpScreen(Host &h)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s%06lld.ppm", h.dump_prefix, h.now / 1000000);
+    if (h.lcd.write_ppm(path))
+        fprintf(stderr, "host: could not write %s\n", path);
+}
+
+static void report()
+{
+    Host &h = host();
+    fflush(stdout);
+    fprintf(stderr, "host: %lld ms of virtual time, %u bytes sent to the LCD at %d baud, %u answer bytes overrun\n",
+        h.now / 1000000, h.lcd_uart.sent, h.lcd_uart.baud, h.lcd_uart.overruns);
+    h.lcd.report(stderr);
+    if (h.dump_prefix) dumpScreen(h);
+}
+
+// Move the LCD line and the screen forward to now
+static void deliver(Host &h)
+{
+    HostUart &u = h.lcd_uart;
+    while (u.shifting && u.shift_done <= h.now) {
+        h.lcd.receive(u.shift, u.baud, u.shift_done);
+        u.sent++;
+        if (u.tx_count) {
+            u.shift = u.tx_fifo[u.tx_head];
+            u.tx_head = (u.tx_head + 1) % HOST_UART_FIFO;
+            u.tx_count--;
+            u.shift_done += byteTime(u);
+            if (!u.tx_count) u.thre_pending = 1;
+        } else {
+            u.shifting = 0;
+        }
+    }
+    h.lcd.run(h.now);
+    while (h.lcd.reply_due() >= 0 && h.lcd.reply_due() <= h.now) {
+        int c = h.lcd.take_reply(u.baud);
+        if (c < 0) continue;
+        if (u.rx_count == HOST_UART_FIFO) {
+            u.overruns++;
+            continue;
+        }
+        u.rx_fifo[(u.rx_head + u.rx_count) % HOST_UART_FIFO] = c;
+        u.rx_count++;
+    }
+}
+
+// Run the handlers of any interrupts that are due, unless masked
+static void dispatch(Host &h)
+{
+    if (h.irq_disabled || h.in_isr) return;
+    h.in_isr = 1;
+    HostUart &u = h.lcd_uart;
+    for (int n = u.rx_count; n > 0 && u.rx_count && u.irq[Serial::RxIrq].attached(); n--) {
+        u.irq[Serial::RxIrq].call();
+        h.handled++;
+    }
+    if (u.thre_pending) {
+        u.thre_pending = 0;
+        u.irq[Serial::TxIrq].call();
+        h.handled++;
+    }
+    for (int i = 0; i < HOST_TIMEOUTS; i++) {
+        Timeout *t = h.timeouts[i];
+        if (t && t->_due >= 0 && t->_due <= h.now) {
+            t->_due = -1;
+            t->_fp.call();
+            h.handled++;
+        }
+    }
+    for (int i = 0; i < HOST_PIN_IRQS; i++) {
+        InterruptIn *in = h.pin_irqs[i];
+        if (!in || in->read() == in->_level)
+            continue;
+        in->_level = in->read();
+        FunctionPointer &fp = in->_level ? in->_rise : in->_fall;
+        if (fp.attached()) {
+            fp.call();
+            h.handled++;
+        }
+    }
+    h.in_isr = 0;
+}
+
+// When anything is next due to happen, or -1 if nothing ever will
+static long long nextEvent(Host &h)
+{
+    long long next = -1;
+    HostUart &u = h.lcd_uart;
+    if (u.shifting)
+        next = u.shift_done;
+    long long lcd = h.lcd.next_event();
+    if (lcd >= 0 && (next < 0 || lcd < next)) next = lcd;
+    for (int i = 0; i < HOST_TIMEOUTS; i++) {
+        Timeout *t = h.timeouts[i];
+        if (t && t->_due > h.now && (next < 0 || t->_due < next)) next = t->_due;
+    }
+    if (h.input_next < h.input_count && (next < 0 || h.inputs[h.input_next].at < next))
+        next = h.inputs[h.input_next].at;
+    if (h.accel_pin >= 0 && (next < 0 || h.accel_next < next))
+        next = h.accel_next;
+    return next;
+}
+
+static void runUntil(long long until)
+{
+    Host &h = host();
+    for (;;) {
+        playScript(h);
+        sampleAccel(h);
+        deliver(h);
+        dispatch(h);
+        if (h.now >= until) break;
+
+        long long next = nextEvent(h);
+        if (next < 0 || next > until) next = until;
+        h.now = next > h.now ? next : h.now + 1;
+    }
+    if (h.in_isr) return;
+    if (h.dump_prefix && h.now >= h.next_dump) {
+        dumpScreen(h);
+        while (h.next_dump <= h.now) h.next_dump += h.dump_every;
+    }
+    if (h.run_until >= 0 && h.now >= h.run_until) exit(0);
+}
+
+// === [virtual time] ===
+long long host_time_ns()
+{
+    return host().now;
+}
+
+void host_advance_ns(long long ns)
+{
+    Host &h = host();
+    if (h.in_isr) return;           // handlers never wait for time to pass
+    runUntil(h.now + (ns > 0 ? ns : 1));
+}
+
+void wait(float s)
+{
+    host_advance_ns((long long)(s * 1e9f));
+}
+
+void wait_ms(int ms)
+{
+    host_advance_ns(ms > 0 ? ms * 1000000LL : 1000);
+}
+
+void wait_us(int us)
+{
+    host_advance_ns(us > 0 ? us * 1000LL : 1000);
+}
+
+void __disable_irq(void)
+{
+    host().irq_disabled = 1;
+}
+
+void __enable_irq(void)
+{
+    host().irq_disabled = 0;
+    host_advance_ns(HOST_IRQ_NS);
+}
+
+void sleep(void)
+{
+    Host &h = host();
+    if (h.in_isr) return;
+    unsigned int handled = h.handled;
+    while (h.handled == handled) {
+        long long next = nextEvent(h);
+        if (next < 0) {
+            fprintf(stderr, "host: asleep with nothing left to wake it\n");
+            exit(0);
+        }
+        runUntil(next > h.now ? next : h.now + 1);
+    }
+}
+
+Timeout::Timeout() : _due(-1)
+{
+    Host &h = host();
+    for (int i = 0; i < HOST_TIMEOUTS; i++) {
+        if (!h.timeouts[i]) {
+            h.timeouts[i] = this;
+            return;
+        }
+    }
+    fprintf(stderr, "host: more than %d Timeouts\n", HOST_TIMEOUTS);
+    exit(1);
+}
+
+Timeout::~Timeout()
+{
+    Host &h = host();
+    for (int i = 0; i < HOST_TIMEOUTS; i++)
+        if (h.timeouts[i] == this) h.timeouts[i] = 0;
+}
+
+// === [serial ports] ===
+Serial::Serial(PinName tx, PinName rx, const char *name)
+{
+    Host &h = host();
+    _uart = tx == USBTX ? &h.console : tx == p9 ? &h.lcd_uart : &h.other;
+}
+
+void Serial::baud(int baudrate)
+{
+    _uart->baud = baudrate;
+}
+
+int Serial::readable()
+{
+    return _uart->rx_count > 0;
+}
+
+int Serial::writeable()
+{
+    return !_uart->is_lcd || _uart->tx_count < HOST_UART_FIFO;
+}
+
+int Serial::putc(int c)
+{
+    HostUart &u = *_uart;
+    if (u.is_console) {
+        fputc(c, stdout);
+        host_advance_ns(byteTime(u));
+        return c;
+    }
+    if (!u.is_lcd) return c;
+    while (u.tx_count == HOST_UART_FIFO) host_advance_ns(u.shift_done - host_time_ns());
+    if (!u.shifting) {
+        u.shifting = 1;
+        u.shift = c;
+        u.shift_done = host_time_ns() + byteTime(u);
+        u.thre_pending = 1;
+    } else {
+        u.tx_fifo[(u.tx_head + u.tx_count) % HOST_UART_FIFO] = c;
+        u.tx_count++;
+    }
+    return c;
+}
+
+int Serial::getc()
+{
+    HostUart &u = *_uart;
+    if (u.is_console) {             // the console reads stdin
+        int c = fgetc(stdin);
+        return c == EOF ? -1 : c;
+    }
+    if (!u.is_lcd) return -1;
+    while (!u.rx_count) host_advance_ns(1000);
+    int c = u.rx_fifo[u.rx_head];
+    u.rx_head = (u.rx_head + 1) % HOST_UART_FIFO;
+    u.rx_count--;
+    return c;
+}
+
+void Serial::attach(void (*fptr)(void), IrqType type)
+{
+    _uart->irq[type].attach(fptr);
+}
+
+void Serial::attach(FunctionPointer fp, IrqType type)
+{
+    _uart->irq[type] = fp;
+}
+
+// === [scripted inputs] ===
+int host_pin(PinName pin)
+{
+    return pin >= 0 && pin < HOST_PINS ? host().pins[pin] : 1;
+}
+
+void host_accel(double *x, double *y, double *z)
+{
+    Host &h = host();
+    *x = h.accel[0];
+    *y = h.accel[1];
+    *z = h.accel[2];
+}
+
+void host_accel_ready(PinName pin, long long period_ns)
+{
+    Host &h = host();
+    h.accel_pin = pin >= 0 && pin < HOST_PINS ? pin : -1;
+    h.accel_period = period_ns;
+    h.accel_next = h.now + period_ns;
+}
+
+void host_accel_sampled()
+{
+    Host &h = host();
+    if (h.accel_pin >= 0) h.pins[h.accel_pin] = 1;
+}
+
+// === [emulated LCD] ===
+void host_lcd_calibrated()
+{
+    Host &h = host();
+    deliver(h);
+    h.lcd.end_calibration();
+}
+
+// === [pins] ===
+int DigitalIn::read()
+{
+    return host_pin(_pin);
+}
+
+InterruptIn::InterruptIn(PinName pin) : DigitalIn(pin), _level(host_pin(pin))
+{
+    Host &h = host();
+    for (int i = 0; i < HOST_PIN_IRQS; i++) {
+        if (!h.pin_irqs[i]) {
+            h.pin_irqs[i] = this;
+            return;
+        }
+    }
+    fprintf(stderr, "host: more than %d InterruptIns\n", HOST_PIN_IRQS);
+    exit(1);
+}
+
+InterruptIn::~InterruptIn()
+{
+    Host &h = host();
+    for (int i = 0; i < HOST_PIN_IRQS; i++)
+        if (h.pin_irqs[i] == this) h.pin_irqs[i] = 0;
+}
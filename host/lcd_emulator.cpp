@@ -0,0 +1,486 @@
+// ============================================
+// A software uLCD-144-G2 for the host build; see lcd_emulator.h.
+//=============================================
+#include "lcd_emulator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Service-time model: rough figures for a Goldelox, only meant to make
+// relative costs (and pacing mistakes) show up. Every command costs
+// LCD_COMMAND_NS to decode plus LCD_PIXEL_NS per pixel it touches; a blit
+// also needs LCD_BLIT_SETUP_NS after its header before it takes pixels.
+#define LCD_COMMAND_NS     8000LL
+#define LCD_PIXEL_NS       50LL
+#define LCD_BLIT_SETUP_NS  300000LL
+#define LCD_BAUD_SWITCH_NS 100000000LL  // the ACK comes 100ms after a change
+
+#define ACK 0x06
+#define NAK 0x15
+
+// 5x7 glyphs for ' ' to '~', one byte per column, bit 0 at the top
+static const unsigned char font5x7[95][5] = {
+    {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, // ' ' ! "
+    {0x14,0x7F,0x14,0x7F,0x14}, {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, // # $ %
+    {0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00}, {0x00,0x1C,0x22,0x41,0x00}, // & ' (
+    {0x00,0x41,0x22,0x1C,0x00}, {0x14,0x08,0x3E,0x08,0x14}, {0x08,0x08,0x3E,0x08,0x08}, // ) * +
+    {0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00}, // , - .
+    {0x20,0x10,0x08,0x04,0x02}, {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, // / 0 1
+    {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31}, {0x18,0x14,0x12,0x7F,0x10}, // 2 3 4
+    {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03}, // 5 6 7
+    {0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00}, // 8 9 :
+    {0x00,0x56,0x36,0x00,0x00}, {0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14}, // ; < =
+    {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06}, {0x32,0x49,0x79,0x41,0x3E}, // > ? @
+    {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22}, // A B C
+    {0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, // D E F
+    {0x3E,0x41,0x49,0x49,0x7A}, {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, // G H I
+    {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, {0x7F,0x40,0x40,0x40,0x40}, // J K L
+    {0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E}, // M N O
+    {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, // P Q R
+    {0x46,0x49,0x49,0x49,0x31}, {0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F}, // S T U
+    {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F}, {0x63,0x14,0x08,0x14,0x63}, // V W X
+    {0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00}, // Y Z [
+    {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04}, // \ ] ^
+    {0x40,0x40,0x40,0x40,0x40}, {0x00,0x01,0x02,0x04,0x00}, {0x20,0x54,0x54,0x54,0x78}, // _ ` a
+    {0x7F,0x48,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x20}, {0x38,0x44,0x44,0x48,0x7F}, // b c d
+    {0x38,0x54,0x54,0x54,0x18}, {0x08,0x7E,0x09,0x01,0x02}, {0x0C,0x52,0x52,0x52,0x3E}, // e f g
+    {0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x44,0x3D,0x00}, // h i j
+    {0x7F,0x10,0x28,0x44,0x00}, {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x18,0x04,0x78}, // k l m
+    {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38}, {0x7C,0x14,0x14,0x14,0x08}, // n o p
+    {0x08,0x14,0x14,0x18,0x7C}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x20}, // q r s
+    {0x04,0x3F,0x44,0x40,0x20}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C}, // t u v
+    {0x3C,0x40,0x30,0x40,0x3C}, {0x44,0x28,0x10,0x28,0x44}, {0x0C,0x50,0x50,0x50,0x3C}, // w x y
+    {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00}, {0x00,0x00,0x7F,0x00,0x00}, // z { |
+    {0x00,0x41,0x36,0x08,0x00}, {0x08,0x04,0x08,0x10,0x08}                              // } ~
+};
+
+// Argument bytes after FF and the opcode; -1 for opcodes the screen rejects
+static int argBytes(unsigned char opcode)
+{
+    switch (opcode) {
+        case 0xD7: case 0xB1: case 0xB7: case 0xB6: case 0xB2:
+            return 0;
+        case 0x6E: case 0x7E: case 0x68: case 0x66: case 0x76: case 0x75:
+        case 0x74: case 0x73: case 0x77: case 0x7F: case 0x7D: case 0x7C:
+        case 0x7B: case 0xD8: case 0xFE: case 0xB5: case 0xB4:
+            return 2;
+        case 0xCA: case 0xE4: case 0xB9: case 0xB8: case 0xB3: case 0xBB:
+            return 4;
+        case 0xCB: case 0xBA:
+            return 6;
+        case 0xCD: case 0xCC:
+            return 8;
+        case 0xCE: case 0xCF: case 0xD2:
+            return 10;
+        case 0xC9:
+            return 14;
+        default:
+            return -1;
+    }
+}
+
+// Names for the report
+static const struct { unsigned char prefix, opcode; const char *name; } opcode_names[] = {
+    {0xFF, 0xD7, "cls"}, {0xFF, 0xCE, "filled_rectangle"}, {0xFF, 0xCF, "rectangle"},
+    {0xFF, 0xD2, "line"}, {0xFF, 0xCB, "pixel"}, {0xFF, 0xCA, "read_pixel"},
+    {0xFF, 0xCD, "circle"}, {0xFF, 0xCC, "filled_circle"}, {0xFF, 0xC9, "triangle"},
+    {0xFF, 0xE4, "move_cursor"}, {0xFF, 0xFE, "putchar"}, {0xFF, 0x7F, "text_color"},
+    {0xFF, 0x7E, "text_background"}, {0xFF, 0x6E, "background"}, {0xFF, 0x7D, "set_font"},
+    {0xFF, 0x7C, "text_width"}, {0xFF, 0x7B, "text_height"}, {0xFF, 0x77, "text_mode"},
+    {0x00, 0x0A, "blit"}, {0x00, 0x06, "text_string"}, {0x00, 0x0B, "baudrate"}
+};
+
+// The divisors of the 00 0B command, as in uLCD_4DGL.h
+static int baudFromDivisor(int divisor)
+{
+    switch (divisor) {
+        case 0: return 3000000;
+        case 1: return 1500000;
+        case 2: return 1000000;
+        case 3: return 750000;
+        case 4: return 600000;
+        case 6: return 428571;
+        case 8: return 333333;
+        case 10: return 272727;
+        default: return 3000000 / (divisor + 1);
+    }
+}
+
+LcdEmulator::LcdEmulator()
+{
+    memset(fb, 0, sizeof(fb));
+    bytes_in = dropped = calibration_dropped = garbled = unknown = commands = 0;
+    memset(opcode_count, 0, sizeof(opcode_count));
+    busy_ns = 0;
+    buf_head = buf_count = 0;
+    ready_at = 0;
+    baud = 9600;
+    reply_head = reply_count = 0;
+    line_free = 0;
+    cmd_len = 0;
+    cmd_need = 0;
+    cmd_start = 0;
+    blit_left = 0;
+    background = text_background = 0x0000;
+    text_color = 0xFFFF;
+    text_opaque = 0;
+    pen_wireframe = 0;
+    font = 0;
+    font_w = 7;
+    font_h = 8;
+    text_wf = text_hf = 1;
+    cursor_x = cursor_y = 0;
+    memset(setting, 0, sizeof(setting));
+}
+
+void LcdEmulator::receive(unsigned char c, int line_baud, long long now)
+{
+    run(now);
+    if (line_baud != baud) {
+        garbled++;
+        return;
+    }
+    if (buf_count == LCD_EMU_BUFFER) {
+        dropped++;
+        return;
+    }
+    int i = (buf_head + buf_count) % LCD_EMU_BUFFER;
+    buf[i] = c;
+    buf_at[i] = now;
+    buf_count++;
+    run(now);
+}
+
+void LcdEmulator::run(long long now)
+{
+    while (buf_count) {
+        long long t = buf_at[buf_head] > ready_at ? buf_at[buf_head] : ready_at;
+        if (t > now) break;
+        unsigned char c = buf[buf_head];
+        buf_head = (buf_head + 1) % LCD_EMU_BUFFER;
+        buf_count--;
+        bytes_in++;
+        consume(c, t);
+    }
+}
+
+long long LcdEmulator::next_event()
+{
+    long long next = reply_due();
+    if (buf_count) {
+        long long t = buf_at[buf_head] > ready_at ? buf_at[buf_head] : ready_at;
+        if (next < 0 || t < next) next = t;
+    }
+    return next;
+}
+
+long long LcdEmulator::reply_due()
+{
+    return reply_count ? reply_at[reply_head] : -1;
+}
+
+int LcdEmulator::take_reply(int line_baud)
+{
+    if (!reply_count) return -1;
+    int c = reply[reply_head];
+    int sent_baud = reply_baud[reply_head];
+    reply_head = (reply_head + 1) % LCD_EMU_REPLY;
+    reply_count--;
+    if (sent_baud != line_baud) {
+        garbled++;
+        return -1;
+    }
+    return c;
+}
+
+void LcdEmulator::consume(unsigned char c, long long t)
+{
+    if (blit_left) {                                    // pixels go straight to the screen
+        if (blit_left & 1) {
+            int i = (blit_w * blit_h * 2 - blit_left) / 2;
+            plot(blit_x + i % blit_w, blit_y + i / blit_w, (blit_hi << 8) | c);
+        } else {
+            blit_hi = c;
+        }
+        if (--blit_left == 0) {
+            commands++;
+            opcode_count[0][0x0A]++;
+            ready_at = t + LCD_COMMAND_NS;
+            busy_ns += LCD_COMMAND_NS;
+            answer_word(-1, ready_at);
+        }
+        return;
+    }
+    if (cmd_len == 0) {
+        if (c != 0x00 && c != 0xFF) {
+            unknown++;
+            return;
+        }
+        cmd_start = t;
+    }
+    cmd[cmd_len++] = c;
+    if (cmd_len == 2) {
+        if (cmd[0] == 0xFF) {
+            int args = argBytes(c);
+            cmd_need = args < 0 ? 0 : 2 + args;
+        } else if (c == 0x0A) {
+            cmd_need = 10;
+        } else if (c == 0x06) {
+            cmd_need = -1;
+        } else if (c == 0x0B) {
+            cmd_need = 4;
+        } else {
+            cmd_need = 0;
+        }
+        if (cmd_need == 0) {                            // not a command this screen knows
+            unknown += 2;
+            cmd_len = 0;
+            unsigned char nak = NAK;
+            answer(&nak, 1, t + LCD_COMMAND_NS);
+            return;
+        }
+    }
+    if (cmd_len < 2) return;
+    if (cmd_need < 0 ? c == 0 || cmd_len == (int)sizeof(cmd) : cmd_len == cmd_need) {
+        execute(t);
+        cmd_len = 0;
+    }
+}
+
+void LcdEmulator::execute(long long t)
+{
+    unsigned char prefix = cmd[0], opcode = cmd[1];
+    long long pixels = 0;
+    int old = setting[opcode];
+    int value = cmd_len >= 4 ? word(2) : 0;
+    int reply_word = -1;                                // -1: ACK alone
+
+    if (prefix == 0x00) {
+        switch (opcode) {
+            case 0x0A:                                  // blit: pixels follow after setup
+                blit_x = word(2);
+                blit_y = word(4);
+                blit_w = word(6);
+                blit_h = word(8);
+                blit_left = blit_w * blit_h * 2;
+                ready_at = t + LCD_BLIT_SETUP_NS;
+                busy_ns += LCD_BLIT_SETUP_NS;
+                if (!blit_left) answer_word(-1, ready_at);
+                return;
+            case 0x06:                                  // text string at the cursor
+                for (int i = 2; cmd[i]; i++) {
+                    glyph(cmd[i]);
+                    pixels += font_w * text_wf * font_h * text_hf;
+                }
+                reply_word = cmd_len - 3;
+                break;
+            case 0x0B: {                                // baud rate: answered at the new speed
+                commands++;
+                opcode_count[0][opcode]++;
+                baud = baudFromDivisor(value);
+                ready_at = t + LCD_BAUD_SWITCH_NS;
+                answer_word(-1, ready_at);
+                return;
+            }
+        }
+    } else {
+        switch ((unsigned char)opcode) {
+            case 0xD7:                                  // cls
+                fill(0, 0, LCD_EMU_SIZE - 1, LCD_EMU_SIZE - 1, background);
+                cursor_x = cursor_y = 0;
+                pixels = LCD_EMU_SIZE * LCD_EMU_SIZE;
+                break;
+            case 0xCE:                                  // filled rectangle
+                fill(word(2), word(4), word(6), word(8), word(10));
+                pixels = (long long)(abs(word(6) - word(2)) + 1) * (abs(word(8) - word(4)) + 1);
+                break;
+            case 0xCF:                                  // rectangle
+                line(word(2), word(4), word(6), word(4), word(10));
+                line(word(2), word(8), word(6), word(8), word(10));
+                line(word(2), word(4), word(2), word(8), word(10));
+                line(word(6), word(4), word(6), word(8), word(10));
+                pixels = 2 * (abs(word(6) - word(2)) + abs(word(8) - word(4)) + 2);
+                break;
+            case 0xD2:                                  // line
+                line(word(2), word(4), word(6), word(8), word(10));
+                pixels = abs(word(6) - word(2)) + abs(word(8) - word(4)) + 1;
+                break;
+            case 0xC9:                                  // triangle
+                line(word(2), word(4), word(6), word(8), word(14));
+                line(word(6), word(8), word(10), word(12), word(14));
+                line(word(10), word(12), word(2), word(4), word(14));
+                pixels = 3 * LCD_EMU_SIZE;
+                break;
+            case 0xCD:                                  // circle
+            case 0xCC:                                  // filled circle
+                circle(word(2), word(4), word(6), word(8), opcode == 0xCC && !pen_wireframe);
+                pixels = (long long)word(6) * (opcode == 0xCC ? 4 * word(6) : 7);
+                break;
+            case 0xCB:                                  // pixel
+                plot(word(2), word(4), word(6));
+                pixels = 1;
+                break;
+            case 0xCA:                                  // read pixel
+                reply_word = word(2) < LCD_EMU_SIZE && word(4) < LCD_EMU_SIZE
+                    ? fb[word(4) * LCD_EMU_SIZE + word(2)] : 0;
+                break;
+            case 0xE4:                                  // move cursor: line, column
+                cursor_y = word(2) * font_h * text_hf;
+                cursor_x = word(4) * font_w * text_wf;
+                break;
+            case 0xFE:                                  // putchar
+                glyph(cmd[3]);
+                pixels = font_w * text_wf * font_h * text_hf;
+                break;
+            case 0x7F: reply_word = text_color; text_color = value; break;
+            case 0x7E: reply_word = text_background; text_background = value; break;
+            case 0x6E: reply_word = background; background = value; break;
+            case 0x7D:                                  // font: cell sizes as the driver assumes
+                reply_word = font;
+                font = value;
+                font_w = value == 0 ? 7 : value == 4 ? 6 : value == 3 ? 12 : 8;
+                font_h = value == 2 ? 12 : value == 3 ? 16 : 8;
+                break;
+            case 0x7C: reply_word = text_wf; text_wf = value ? value : 1; break;
+            case 0x7B: reply_word = text_hf; text_hf = value ? value : 1; break;
+            case 0x77: reply_word = text_opaque; text_opaque = value; break;
+            case 0xD8: reply_word = pen_wireframe; pen_wireframe = value; break;
+            case 0x76: case 0x75: case 0x74: case 0x73: case 0x66:
+                reply_word = old;
+                setting[opcode] = value;
+                break;
+            case 0xB1: case 0xB7: case 0xB6:            // no card: nothing to read
+                reply_word = 0;
+                break;
+        }
+    }
+
+    commands++;
+    opcode_count[prefix ? 1 : 0][opcode]++;
+    long long service = LCD_COMMAND_NS + pixels * LCD_PIXEL_NS;
+    ready_at = t + service;
+    busy_ns += service;
+    answer_word(reply_word, ready_at);
+}
+
+void LcdEmulator::answer(const unsigned char *bytes, int n, long long t)
+{
+    for (int i = 0; i < n && reply_count < LCD_EMU_REPLY; i++) {
+        long long start = t > line_free ? t : line_free;
+        line_free = start + 10000000000LL / baud;
+        int j = (reply_head + reply_count) % LCD_EMU_REPLY;
+        reply[j] = bytes[i];
+        reply_at[j] = line_free;
+        reply_baud[j] = baud;
+        reply_count++;
+    }
+}
+
+void LcdEmulator::answer_word(int value, long long t)
+{
+    unsigned char bytes[3] = { ACK, (unsigned char)(value >> 8), (unsigned char)value };
+    answer(bytes, value < 0 ? 1 : 3, t);
+}
+
+void LcdEmulator::plot(int x, int y, unsigned short color)
+{
+    if (x >= 0 && x < LCD_EMU_SIZE && y >= 0 && y < LCD_EMU_SIZE)
+        fb[y * LCD_EMU_SIZE + x] = color;
+}
+
+void LcdEmulator::fill(int x0, int y0, int x1, int y1, unsigned short color)
+{
+    if (x0 > x1) { int s = x0; x0 = x1; x1 = s; }
+    if (y0 > y1) { int s = y0; y0 = y1; y1 = s; }
+    for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+            plot(x, y, color);
+}
+
+void LcdEmulator::line(int x0, int y0, int x1, int y1, unsigned short color)
+{
+    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    for (;;) {
+        plot(x0, y0, color);
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x0 += sx; }
+        if (e2 <= dx) { err += dx; y0 += sy; }
+    }
+}
+
+void LcdEmulator::circle(int cx, int cy, int r, unsigned short color, int filled)
+{
+    int x = r, y = 0, err = 1 - r;
+    while (x >= y) {
+        if (filled) {
+            fill(cx - x, cy + y, cx + x, cy + y, color);
+            fill(cx - x, cy - y, cx + x, cy - y, color);
+            fill(cx - y, cy + x, cx + y, cy + x, color);
+            fill(cx - y, cy - x, cx + y, cy - x, color);
+        } else {
+            plot(cx + x, cy + y, color); plot(cx - x, cy + y, color);
+            plot(cx + x, cy - y, color); plot(cx - x, cy - y, color);
+            plot(cx + y, cy + x, color); plot(cx - y, cy + x, color);
+            plot(cx + y, cy - x, color); plot(cx - y, cy - x, color);
+        }
+        y++;
+        if (err < 0) {
+            err += 2 * y + 1;
+        } else {
+            x--;
+            err += 2 * (y - x) + 1;
+        }
+    }
+}
+
+void LcdEmulator::glyph(unsigned char c)
+{
+    int cell_w = font_w * text_wf, cell_h = font_h * text_hf;
+    if (cursor_x + cell_w > LCD_EMU_SIZE) {             // wrap to the next line
+        cursor_x = 0;
+        cursor_y += cell_h;
+    }
+    const unsigned char *columns = c >= 0x20 && c < 0x7F ? font5x7[c - 0x20] : font5x7[0];
+    for (int col = 0; col < font_w; col++) {
+        unsigned char bits = col >= 1 && col <= 5 ? columns[col - 1] : 0;
+        for (int row = 0; row < font_h; row++) {
+            int on = (bits >> row) & 1;
+            if (!on && !text_opaque) continue;
+            fill(cursor_x + col * text_wf, cursor_y + row * text_hf,
+                 cursor_x + (col + 1) * text_wf - 1, cursor_y + (row + 1) * text_hf - 1,
+                 on ? text_color : text_background);
+        }
+    }
+    cursor_x += cell_w;
+}
+
+int LcdEmulator::write_ppm(const char *path) const
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    fprintf(f, "P6\n%d %d\n255\n", LCD_EMU_SIZE, LCD_EMU_SIZE);
+    for (int i = 0; i < LCD_EMU_SIZE * LCD_EMU_SIZE; i++) {
+        unsigned short p = fb[i];
+        unsigned char rgb[3] = {
+            (unsigned char)(((p >> 11) & 0x1F) * 255 / 31),
+            (unsigned char)(((p >> 5) & 0x3F) * 255 / 63),
+            (unsigned char)((p & 0x1F) * 255 / 31)
+        };
+        fwrite(rgb, 1, 3, f);
+    }
+    return fclose(f);
+}
+
+void LcdEmulator::report(FILE *out) const
+{
+    fprintf(out, "lcd: %u bytes in, %u commands, busy %lld ms, %u dropped (and %u while calibrating), "
+        "%u garbled, %u unknown\n", bytes_in, commands, busy_ns / 1000000, dropped - calibration_dropped,
+        calibration_dropped, garbled, unknown);
+    for (unsigned int i = 0; i < sizeof(opcode_names) / sizeof(opcode_names[0]); i++) {
+        unsigned int n = opcode_count[opcode_names[i].prefix ? 1 : 0][opcode_names[i].opcode];
+        if (n) fprintf(out, "lcd:   %-16s %u\n", opcode_names[i].name, n);
+    }
+}
@@ -0,0 +1,93 @@
+// ============================================
+// A software uLCD-144-G2: decodes the Goldelox serial commands the driver
+// sends into a 128x128 RGB565 framebuffer, with a rough model of how long
+// each command keeps the screen busy, so the host build can check both
+// what is drawn and whether the link would keep up.
+//=============================================
+#ifndef LCD_EMULATOR_H
+#define LCD_EMULATOR_H
+
+#include <stdio.h>
+
+#define LCD_EMU_SIZE   128
+#define LCD_EMU_BUFFER 16       // bytes the screen's UART holds while it is busy
+#define LCD_EMU_REPLY  64       // answer bytes waiting to go back
+
+class LcdEmulator {
+public:
+    LcdEmulator();
+
+    /** A byte sent at line baud arrives at time now (ns). It is lost if the
+     * screen's buffer is full, and garbled if the screen runs another baud */
+    void receive(unsigned char c, int line_baud, long long now);
+    /** Let the screen work through its buffer up to time now */
+    void run(long long now);
+    /** When the screen next has something to do or say, or -1 */
+    long long next_event();
+    /** When the next answer byte has fully arrived back at the mbed, or -1 */
+    long long reply_due();
+    /** Take that answer byte; -1 if it was garbled by a baud mismatch */
+    int take_reply(int line_baud);
+
+    /** Write the framebuffer as a binary PPM; 0 on success */
+    int write_ppm(const char *path) const;
+    /** Print the link and command statistics */
+    void report(FILE *out) const;
+    /** The driver's calibration is over: bytes dropped so far were lost to
+     * it, and are reported apart from the ones dropped later */
+    void end_calibration() { calibration_dropped = dropped; }
+
+    unsigned short fb[LCD_EMU_SIZE * LCD_EMU_SIZE];    // RGB565, row by row
+
+    // Statistics
+    unsigned int bytes_in;          // bytes that reached the screen
+    unsigned int dropped;           // bytes lost to a full buffer
+    unsigned int calibration_dropped;   // of those, bytes lost while calibrating
+    unsigned int garbled;           // bytes lost to a baud mismatch, either way
+    unsigned int unknown;           // bytes that did not start a known command
+    unsigned int commands;          // commands completed
+    unsigned int opcode_count[2][256];  // by prefix (0x00, 0xFF) and opcode
+    long long    busy_ns;           // time spent executing commands
+
+private:
+    void consume(unsigned char c, long long t);
+    void execute(long long t);
+    void answer(const unsigned char *bytes, int n, long long t);
+    void answer_word(int value, long long t);
+    void plot(int x, int y, unsigned short color);
+    void fill(int x0, int y0, int x1, int y1, unsigned short color);
+    void line(int x0, int y0, int x1, int y1, unsigned short color);
+    void circle(int cx, int cy, int r, unsigned short color, int filled);
+    void glyph(unsigned char c);
+    int  word(int i) const { return (cmd[i] << 8) | cmd[i + 1]; }
+
+    // Bytes waiting in the screen's UART, and when each arrived
+    unsigned char buf[LCD_EMU_BUFFER];
+    long long     buf_at[LCD_EMU_BUFFER];
+    int           buf_head, buf_count;
+    long long     ready_at;         // the screen takes its next byte from here on
+    int           baud;
+
+    // Answers on their way back: byte, arrival time, baud it was sent at
+    unsigned char reply[LCD_EMU_REPLY];
+    long long     reply_at[LCD_EMU_REPLY];
+    int           reply_baud[LCD_EMU_REPLY];
+    int           reply_head, reply_count;
+    long long     line_free;        // the screen's transmit line is free from here on
+
+    // Command being decoded
+    unsigned char cmd[1024];
+    int           cmd_len, cmd_need;    // -1: until a NUL
+    long long     cmd_start;
+    int           blit_x, blit_y, blit_w, blit_h, blit_left;
+    unsigned char blit_hi;
+
+    // Drawing state
+    unsigned short background, text_color, text_background;
+    int           text_opaque, pen_wireframe;
+    int           font, font_w, font_h, text_wf, text_hf;
+    int           cursor_x, cursor_y;
+    int           setting[256];     // last value of each simple setter
+};
+
+#endif // LCD_EMULATOR_H
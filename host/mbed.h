@@ -0,0 +1,273 @@
+// ============================================
+// Host stand-ins for the parts of the mbed API the game uses, so it can be
+// built and run on Linux. Time is virtual: it only moves when the program
+// waits, and the UART wired to the LCD pins talks to an emulated screen.
+// See host.cpp.
+//=============================================
+#ifndef HOST_MBED_H
+#define HOST_MBED_H
+
+// Lets code shared with the board call the host hooks below
+#define MBED_HOST 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <stdint.h>
+
+typedef enum {
+    p5 = 5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17, p18, p19,
+    p20, p21, p22, p23, p24, p25, p26, p27, p28, p29, p30,
+    USBTX, USBRX,
+    NC = -1
+} PinName;
+
+typedef enum {
+    PullUp, PullDown, PullNone, OpenDrain
+} PinMode;
+
+// === [virtual time] ===
+/** Nanoseconds since the program started, in virtual time */
+long long host_time_ns();
+/** Let virtual time pass, delivering any interrupts that fall due */
+void host_advance_ns(long long ns);
+
+// === [scripted inputs] ===
+/** The level a script holds a pin at (1 unless set), and the accelerometer
+ * reading in g (lying flat unless set). See host.cpp */
+int host_pin(PinName pin);
+void host_accel(double *x, double *y, double *z);
+/** The accelerometer's data-ready line: pin is pulled low every period_ns
+ * until host_accel_sampled is called. NC leaves it unwired */
+void host_accel_ready(PinName pin, long long period_ns);
+void host_accel_sampled();
+
+// === [emulated LCD] ===
+/** The LCD driver has finished calibrating, which overruns the screen on
+ * purpose; the report counts bytes the screen drops after this apart */
+void host_lcd_calibrated();
+
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+
+/** Interrupts are only delivered while enabled, and never nest. Enabling
+ * them also costs a little virtual time, so busy-wait loops make progress */
+void __disable_irq(void);
+void __enable_irq(void);
+
+/** Wait for an interrupt, as __WFI does: virtual time runs on until some
+ * handler has been called */
+void sleep(void);
+
+/** A callback to a function or a member function, as in mbed */
+class FunctionPointer {
+public:
+    FunctionPointer() : _function(0), _object(0), _membercaller(0) {}
+    void attach(void (*function)(void) = 0) {
+        _function = function;
+        _object = 0;
+    }
+    template<typename T>
+    void attach(T *object, void (T::*member)(void)) {
+        _function = 0;
+        _object = object;
+        memcpy(_member, (char *)&member, sizeof(member));
+        _membercaller = &FunctionPointer::membercaller<T>;
+    }
+    void call() {
+        if (_function)
+            _function();
+        else if (_object)
+            _membercaller(_object, _member);
+    }
+    bool attached() const { return _function || _object; }
+
+private:
+    template<typename T>
+    static void membercaller(void *object, char *member) {
+        void (T::*m)(void);
+        memcpy((char *)&m, member, sizeof(m));
+        (((T *)object)->*m)();
+    }
+    void (*_function)(void);
+    void *_object;
+    char _member[16];
+    void (*_membercaller)(void *, char *);
+};
+
+class Timer {
+public:
+    Timer() : _start(0), _elapsed(0), _running(false) {}
+    void start() { if (!_running) { _start = host_time_ns(); _running = true; } }
+    void stop() { _elapsed = elapsed(); _running = false; }
+    void reset() { _start = host_time_ns(); _elapsed = 0; }
+    float read() { return elapsed() / 1e9f; }
+    int read_ms() { return (int)(elapsed() / 1000000); }
+    int read_us() { return (int)(elapsed() / 1000); }
+    operator float() { return read(); }
+
+private:
+    long long elapsed() { return _elapsed + (_running ? host_time_ns() - _start : 0); }
+    long long _start, _elapsed;
+    bool _running;
+};
+
+/** Calls a function once, after a delay in virtual time */
+class Timeout {
+public:
+    Timeout();
+    ~Timeout();
+    void attach(void (*fptr)(void), float t) { _fp.attach(fptr); schedule((long long)(t * 1e9f)); }
+    template<typename T>
+    void attach(T *tptr, void (T::*mptr)(void), float t) { _fp.attach(tptr, mptr); schedule((long long)(t * 1e9f)); }
+    void attach_us(void (*fptr)(void), unsigned int t) { _fp.attach(fptr); schedule(t * 1000LL); }
+    template<typename T>
+    void attach_us(T *tptr, void (T::*mptr)(void), unsigned int t) { _fp.attach(tptr, mptr); schedule(t * 1000LL); }
+    void detach() { _due = -1; }
+
+    // Used by host.cpp
+    long long _due;
+    FunctionPointer _fp;
+
+private:
+    void schedule(long long ns) { _due = host_time_ns() + ns; }
+};
+
+// === [serial ports] ===
+struct HostUart;
+
+class Stream {
+public:
+    Stream(const char *name = 0) {}
+    virtual ~Stream() {}
+    int printf(const char *format, ...) {
+        // newlib reads %D as %ld, which is an int on the LPC1768
+        char fmt[256], buffer[512];
+        int i = 0, in_spec = 0;
+        for (; format[i] && i < (int)sizeof(fmt) - 1; i++) {
+            fmt[i] = format[i];
+            if (in_spec && strchr("diouxXcspfeEgG%D", format[i])) {
+                if (format[i] == 'D') fmt[i] = 'd';
+                in_spec = 0;
+            } else if (format[i] == '%') {
+                in_spec = 1;
+            }
+        }
+        fmt[i] = 0;
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer, sizeof(buffer), fmt, args);
+        va_end(args);
+        for (int i = 0; i < n && i < (int)sizeof(buffer) - 1; i++)
+            _putc(buffer[i]);
+        return n;
+    }
+
+protected:
+    virtual int _putc(int c) = 0;
+    virtual int _getc() = 0;
+};
+
+/** USBTX/USBRX is the console on stdin and stdout; p9/p10 is wired to the
+ * emulated LCD. Other pins go nowhere. */
+class Serial : public Stream {
+public:
+    enum IrqType {
+        RxIrq = 0,
+        TxIrq
+    };
+    Serial(PinName tx, PinName rx, const char *name = 0);
+    void baud(int baudrate);
+    int readable();
+    int writeable();
+    int putc(int c);
+    int getc();
+    void attach(void (*fptr)(void), IrqType type = RxIrq);
+    template<typename T>
+    void attach(T *tptr, void (T::*mptr)(void), IrqType type = RxIrq) {
+        FunctionPointer fp;
+        fp.attach(tptr, mptr);
+        attach(fp, type);
+    }
+
+protected:
+    void attach(FunctionPointer fp, IrqType type);
+    virtual int _putc(int c) { return putc(c); }
+    virtual int _getc() { return getc(); }
+    HostUart *_uart;
+};
+
+// === [pins] ===
+/** Digital inputs read back what the input script sets, 1 otherwise (a
+ * pulled-up button that is not pressed) */
+class DigitalIn {
+public:
+    DigitalIn(PinName pin) : _pin(pin) {}
+    void mode(PinMode pull) {}
+    int read();
+    operator int() { return read(); }
+
+protected:
+    PinName _pin;
+};
+
+/** A digital input whose handlers are called, as interrupts, when the input
+ * script changes its level */
+class InterruptIn : public DigitalIn {
+public:
+    InterruptIn(PinName pin);
+    ~InterruptIn();
+    void rise(void (*fptr)(void)) { _rise.attach(fptr); }
+    template<typename T>
+    void rise(T *tptr, void (T::*mptr)(void)) { _rise.attach(tptr, mptr); }
+    void fall(void (*fptr)(void)) { _fall.attach(fptr); }
+    template<typename T>
+    void fall(T *tptr, void (T::*mptr)(void)) { _fall.attach(tptr, mptr); }
+
+    // Used by host.cpp
+    FunctionPointer _rise, _fall;
+    int _level;                     // the level the handlers last saw
+};
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin) : _value(0) {}
+    void write(int value) { _value = value; }
+    int read() { return _value; }
+    DigitalOut &operator=(int value) { write(value); return *this; }
+    operator int() { return read(); }
+
+private:
+    int _value;
+};
+
+class AnalogOut {
+public:
+    AnalogOut(PinName pin) : _value(0) {}
+    void write(float value) { _value = value; }
+    void write_u16(unsigned short value) { _value = value / 65535.0f; }
+    float read() { return _value; }
+    AnalogOut &operator=(float value) { write(value); return *this; }
+
+private:
+    float _value;
+};
+
+class PwmOut {
+public:
+    PwmOut(PinName pin) : _value(0) {}
+    void period(float seconds) {}
+    void period_ms(int ms) {}
+    void period_us(int us) {}
+    void write(float value) { _value = value; }
+    float read() { return _value; }
+    PwmOut &operator=(float value) { write(value); return *this; }
+
+private:
+    float _value;
+};
+
+#endif // HOST_MBED_H
@@ -0,0 +1,17 @@
+// ============================================
+// Host stand-in for the wave player: there is no speaker, so files are
+// skipped rather than played.
+//=============================================
+#ifndef HOST_WAVE_PLAYER_H
+#define HOST_WAVE_PLAYER_H
+
+#include "mbed.h"
+
+class wave_player {
+public:
+    wave_player(AnalogOut *_dac) {}
+    void play(FILE *wavefile) {}
+    void set_verbosity(int v) {}
+};
+
+#endif // HOST_WAVE_PLAYER_H
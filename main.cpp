@@ -4,7 +4,11 @@
 #include "map.h"
 #include "graphics.h"
 #include "speech.h"
+#include "profile.h"
+#include "flow.h"
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 // Functions in this file
 int get_action(GameInputs inputs);
@@ -16,7 +20,6 @@ void init_powerups();
 void init_npcs(int map);
 void update_npcs();
 void handle_npc_collision(int ghost);
-int sign(int x);
 int main();
 
 /**
@@ -35,31 +38,53 @@ struct {
     int ppower;
 } Player;
 
+/**
+ * The ghosts on the active map. Each one that is alive is also recorded on
+ * the map's occupancy layer under its index (see map_occupant), which must be
+ * kept in step whenever a ghost moves or dies.
+ */
+#define NUM_GHOSTS 3
+
 struct Ghost {
     int x, y;
     int px, py;
     int color;
     int dead;
 };
-static Ghost ghosts[3];
-static int ghosts_fleeing;
+static Ghost ghosts[NUM_GHOSTS];
+static int ghosts_fleeing; // Ticks left until the ghosts stop fleeing
+
+/**
+ * The game advances in fixed ticks of TICK_MS, however long frames take to
+ * draw: each tick reads the inputs once and moves the player at most one
+ * tile. Ghosts step once every GHOST_STEP_TICKS, and eating a dot on the
+ * ghost map makes them flee for FLEE_TICKS.
+ *
+ * When drawing falls behind, up to MAX_CATCH_UP ticks run before the next
+ * frame is drawn, so the game keeps its speed by skipping frames. Beyond
+ * that the game slows down instead of running ever further behind. A tick
+ * that blocks for more than STALL_MS (a speech bubble, the death animation)
+ * is a pause rather than lag, and the clock resumes from its end.
+ */
+#define TICK_MS             100
+#define GHOST_STEP_TICKS    (300 / TICK_MS)
+#define FLEE_TICKS          (10000 / TICK_MS)
+#define MAX_CATCH_UP        4
+#define STALL_MS            1000
 
 static int getGhost(int x, int y) {
-    for (int i = 0; i < 3; i++) {
-        if (!ghosts[i].dead && ghosts[i].x == x && ghosts[i].y == y) {
-            return i;
-        }
-    }
-    return -1;
+    return map_occupant(x, y);
 }
 
-static int getGhostP(int x, int y) {
-    for (int i = 0; i < 3; i++) {
-        if (!ghosts[i].dead && ghosts[i].px == x && ghosts[i].py == y) {
-            return i;
-        }
-    }
-    return -1;
+/**
+ * Move ghost i to (x, y), on the occupancy layer too.
+ */
+static void move_ghost(int i, int x, int y) {
+    if (map_occupant(ghosts[i].x, ghosts[i].y) == i)
+        set_map_occupant(ghosts[i].x, ghosts[i].y, NO_OCCUPANT);
+    ghosts[i].x = x;
+    ghosts[i].y = y;
+    set_map_occupant(x, y, i);
 }
 
 const char* ghost_msg_1[] = {"Hello Pac-Man! I", "can't help you,", "but you can try", "talking to the", "blue ghost."};
@@ -89,6 +114,21 @@ int door_msg_length = 3;
 #define GO_RIGHT 4
 #define GO_UP 5
 #define GO_DOWN 6
+
+/**
+ * Tilt that starts moving the player (0.2 g), and the lesser tilt that keeps
+ * the same move going (0.15 g), so holding the board near the threshold does
+ * not flicker between moving and stopping.
+ */
+#define TILT_START (TILT_COUNTS_PER_G / 5)
+#define TILT_KEEP  (TILT_COUNTS_PER_G * 3 / 20)
+static int tilt_move; // The move the tilt chose last time, or NO_ACTION
+
+static int tilt_threshold(int move)
+{
+    return move == tilt_move ? TILT_KEEP : TILT_START;
+}
+
 int get_action(GameInputs inputs)
 {
     if (inputs.b4)
@@ -100,24 +140,26 @@ int get_action(GameInputs inputs)
 
     Player.pdir = Player.dir;
 
+    int move = NO_ACTION;
     if (abs(inputs.ax) > abs(inputs.ay)) {
-         if (inputs.ax < -0.2) {
+         if (inputs.ax < -tilt_threshold(GO_LEFT)) {
             Player.dir = 2;
-            return GO_LEFT;
-        } else if (inputs.ax > 0.2) {
+            move = GO_LEFT;
+        } else if (inputs.ax > tilt_threshold(GO_RIGHT)) {
             Player.dir = 0;
-            return GO_RIGHT;
+            move = GO_RIGHT;
         }
     } else {
-        if (inputs.ay < -0.2) {
+        if (inputs.ay < -tilt_threshold(GO_DOWN)) {
             Player.dir = 1;
-            return GO_DOWN;
-        } else if (inputs.ay > 0.2) {
+            move = GO_DOWN;
+        } else if (inputs.ay > tilt_threshold(GO_UP)) {
             Player.dir = 3;
-            return GO_UP;
+            move = GO_UP;
         } 
     }
-    return NO_ACTION;
+    tilt_move = move;
+    return move;
 }
 
 /**
@@ -143,6 +185,7 @@ int update_game(int action)
 
     MapItem* item;
     int itemX, itemY;
+    unsigned walkable = map_walkable_around(Player.x, Player.y);
 
     // Do different things based on the each action.
     // You can define functions like "go_up()" that get called for each case.
@@ -150,8 +193,7 @@ int update_game(int action)
     {
         case GO_UP:
         {
-            item = get_north(Player.x, Player.y);
-            if (item && !item->walkable && !Player.isOmni)
+            if (!(walkable & AROUND_BIT(0, -1)) && !Player.isOmni)
                 break;
             if (getGhost(Player.x, Player.y-1) >= 0 && !Player.isOmni) {
                 handle_npc_collision(getGhost(Player.x, Player.y-1));
@@ -162,8 +204,7 @@ int update_game(int action)
         }
         case GO_LEFT:
         {
-            item = get_west(Player.x, Player.y);
-            if (item && !item->walkable && !Player.isOmni)
+            if (!(walkable & AROUND_BIT(-1, 0)) && !Player.isOmni)
                 break;
             if (getGhost(Player.x-1, Player.y) >= 0 && !Player.isOmni) {
                 handle_npc_collision(getGhost(Player.x-1, Player.y));
@@ -174,8 +215,7 @@ int update_game(int action)
         }
         case GO_DOWN:
         {
-            item = get_south(Player.x, Player.y);
-            if (item && !item->walkable && !Player.isOmni)
+            if (!(walkable & AROUND_BIT(0, 1)) && !Player.isOmni)
                 break;
             if (getGhost(Player.x, Player.y+1) >= 0 && !Player.isOmni) {
                 handle_npc_collision(getGhost(Player.x, Player.y+1));
@@ -186,8 +226,7 @@ int update_game(int action)
         }
         case GO_RIGHT:
         {
-            item = get_east(Player.x, Player.y);
-            if (item && !item->walkable && !Player.isOmni)
+            if (!(walkable & AROUND_BIT(1, 0)) && !Player.isOmni)
                 break;
             if (getGhost(Player.x+1, Player.y) >= 0 && !Player.isOmni) {
                 handle_npc_collision(getGhost(Player.x+1, Player.y));
@@ -252,7 +291,7 @@ int update_game(int action)
         Player.power++;
         map_erase(Player.x, Player.y);
         if (get_active_map_index() == 1) {
-            ghosts_fleeing = 100;
+            ghosts_fleeing = FLEE_TICKS;
         }
         result = FULL_DRAW;
     } else if (item && item->type == PRIZE) {
@@ -276,25 +315,120 @@ void npcTalk(int ghost) {
         } else if (Player.questState == 2) {
             Player.questState = 3;
             long_speech(ghost_msg_5, ghost_msg_5_length);
-            add_key_to_player();
         } else if (Player.questState == 3) {
             long_speech(ghost_msg_6, ghost_msg_6_length);
         }
     }
 }
 
+/**
+ * What is currently drawn on one visible tile. draw_game recomputes this for
+ * every tile each frame and only redraws the tiles where it changed.
+ */
+struct Tile {
+    unsigned char sprite;   // Map contents: TILE_EMPTY or 1 + MapItem type
+    unsigned char ghost;    // TILE_EMPTY, 1 + ghost color, or TILE_FLEEING
+    unsigned char player;   // TILE_EMPTY or 1 + direction, + 4 with the key
+};
+#define TILE_EMPTY    0
+#define TILE_FLEEING  4     // A ghost drawn blue while the ghosts flee
+#define TILE_INVALID  0xFF  // Matches nothing, so the tile is always redrawn
+
+/**
+ * The visible tiles, [i+5][j+4] for tile (i,j) relative to the player, as they
+ * are currently drawn on the LCD.
+ */
+static Tile shadow[11][9];
+
+/**
+ * Drawing counters for the last frame: tiles redrawn, bytes sent to the LCD
+ * (including the status bars) and whether the view panned by one tile.
+ */
+static int frame_tiles;
+static unsigned frame_bytes;
+static int frame_pan;
+static int frame_us;
+
+/**
+ * Map position of the player when the shadow was last drawn.
+ */
+static int shadow_x, shadow_y;
+
+/**
+ * What the upper status bar shows, as it was last drawn. A frame can cover
+ * several ticks, so the bar is redrawn whenever it differs from this rather
+ * than when the last tick changed it.
+ */
+struct StatusBar {
+    int x, y, isOmni, map, power, flee_s, questState;
+};
+static StatusBar status_drawn;
+
+/**
+ * Returns true if the tile shows nothing but a black background.
+ */
+static bool tile_empty(const Tile* tile)
+{
+    return !tile->sprite && !tile->ghost && !tile->player;
+}
+
+/**
+ * Draw the lit pixels of a sparse map sprite (see draw_tree_pixels) if the
+ * tile holds nothing else. Returns false if it is not a sparse sprite, and the
+ * whole tile has to be drawn instead.
+ */
+static bool draw_sparse(const Tile* tile, int u, int v, int lit)
+{
+    if (tile->ghost || tile->player)
+        return false;
+    if (tile->sprite == 1 + TREE)
+        draw_tree_pixels(u, v, lit);
+    else if (tile->sprite == 1 + DOOR)
+        draw_door_pixels(u, v, lit);
+    else
+        return false;
+    return true;
+}
+
 /**
  * Entry point for frame drawing. This should be called once per iteration of
  * the game loop. This draws all tiles on the screen, followed by the status
  * bars. If init is zero, this function will optimize drawing by only
  * drawing tiles that have changed from the previous frame.
+ *
+ * When the view pans, most tiles change, but many only change between empty
+ * floor and a sparse sprite. Those are drawn as pixel deltas, and runs of
+ * tiles in a column that become empty are cleared with one rectangle.
+ *
+ * Drawing only queues commands for the LCD, so this returns while the frame
+ * is still being sent and the next frame's input and updates can proceed.
  */
 void draw_game(int init)
 {
-    // Draw game border first
-    if(init) draw_border();
+    Timer frame_timer; frame_timer.start();
+    unsigned start_bytes = uLCD.tx_bytes;
+#if REPORT_DRAW_STATS
+    unsigned start_blits = uLCD.blit_count;
+    unsigned start_blit_us = uLCD.blit_us;
+    unsigned start_wait_us = uLCD.tx_wait_us;
+#endif
+    uLCD.blit_max_us = 0;
+    PROFILE_START(PROF_TILES);
+    frame_tiles = 0;
+    frame_pan = !init && abs(Player.x - shadow_x) + abs(Player.y - shadow_y) == 1;
+    shadow_x = Player.x;
+    shadow_y = Player.y;
+
+    // Draw game border first, and forget what is on the screen
+    if(init) {
+        draw_border();
+        memset(shadow, TILE_INVALID, sizeof(shadow));
+        memset(&status_drawn, 0xFF, sizeof(status_drawn));
+    }
 
-    // Iterate over all visible map tiles
+    // Work out what belongs on every visible tile
+    Tile next[11][9];
+    MapItem* items[11][9];
     for (int i = -5; i <= 5; i++) // Iterate over columns of tiles
     {
         for (int j = -4; j <= 4; j++) // Iterate over one column of tiles
@@ -305,73 +439,99 @@ void draw_game(int init)
             int x = i + Player.x;
             int y = j + Player.y;
 
-            // Compute the previous map (px, py) of this tile
-            int px = i + Player.px;
-            int py = j + Player.py;
-
-            // Compute u,v coordinates for drawing
-            int u = (i+5)*11 + 3;
-            int v = (j+4)*11 + 15;
-
-            // Figure out what to draw
-            DrawFunc draw = NULL;
-            if (i == 0 && j == 0) // Only draw the player on init
+            Tile* tile = &next[i+5][j+4];
+            MapItem** item = &items[i+5][j+4];
+            tile->sprite = tile->ghost = tile->player = TILE_EMPTY;
+            *item = NULL;
+            int ghost;
+            if (i == 0 && j == 0) // The player is always in the center
             {
-                if (init || Player.dir != Player.pdir)
-                    draw_player(u, v, Player.questState, Player.dir);
-                // Never overwrite (0,0) with anything else
-                continue;
+                tile->player = 1 + Player.dir + (Player.questState == 3 ? 4 : 0);
             }
             else if (x >= 0 && y >= 0 && x < map_width() && y < map_height()) // Current (i,j) in the map
             {
-                int ghost;
-                if ((ghost = getGhost(x, y)) >= 0) {
-                    if (init || x != px || y != py
-                        || ghosts[ghost].x != ghosts[ghost].px || ghosts[ghost].y != ghosts[ghost].py) {
-                        draw_ghost(u, v, ghosts[ghost].color, ghosts_fleeing);
-                    }
-                    continue;
-                } else if ((ghost = getGhost(px, py)) >= 0 && (init || x != px || y != py)) {
-                    draw = draw_nothing;
-                } else if ((ghost = getGhostP(x, y)) >= 0 && (init
-                            || ghosts[ghost].x != ghosts[ghost].px || ghosts[ghost].y != ghosts[ghost].py)) {
-                    draw = draw_nothing;
-                } else if ((ghost = getGhostP(px, py)) >= 0 && (init || x != px || y != py
-                            || ghosts[ghost].x != ghosts[ghost].px || ghosts[ghost].y != ghosts[ghost].py)) {
-                    draw = draw_nothing;
-                }
-
-                MapItem* curr_item = get_here(x, y);
-                MapItem* prev_item = get_here(px, py);
-                if (init || curr_item != prev_item) // Only draw if they're different
-                {
-                    if (curr_item) // There's something here! Draw it
-                    {
-                        draw = curr_item->draw;
-                    }
-                    else // There used to be something, but now there isn't
-                    {
-                        draw = draw_nothing;
-                    }
-                }
+                if ((ghost = getGhost(x, y)) >= 0)
+                    tile->ghost = ghosts_fleeing ? TILE_FLEEING : 1 + ghosts[ghost].color;
+                else if ((*item = get_here(x, y)))
+                    tile->sprite = 1 + (*item)->type;
             }
-            else if (init) // If doing a full draw, but we're out of bounds, draw the walls.
+            else // Out of bounds is drawn as wall
             {
-                draw = draw_wall;
+                tile->sprite = 1 + WALL;
+            }
+        }
+    }
+
+    // Draw the tiles that changed, one column at a time
+    for (int c = 0; c < 11; c++)
+    {
+        int u = c*11 + 3;
+        int run = -1; // First row of a run of tiles to clear
+        for (int r = 0; r <= 9; r++)
+        {
+            Tile* tile = &next[c][r];
+            Tile* drawn = &shadow[c][r];
+            bool changed = r < 9 && (tile->sprite != drawn->sprite
+                || tile->ghost != drawn->ghost || tile->player != drawn->player);
+
+            // Collect tiles that become empty into runs
+            if (changed && tile_empty(tile)) {
+                if (run < 0)
+                    run = r;
+                continue;
             }
+            if (run >= 0) {
+                int v = run*11 + 15;
+                if (r - run > 1 || !draw_sparse(&shadow[c][run], u, v, false))
+                    draw_nothing_column(u, v, r - run);
+                frame_tiles += r - run;
+                for (; run < r; run++)
+                    shadow[c][run] = next[c][run];
+                run = -1;
+            }
+            if (!changed)
+                continue;
 
             // Actually draw the tile
-            if (draw) draw(u, v);
+            int v = r*11 + 15;
+            if (tile->player)
+                draw_player(u, v, Player.questState == 3, Player.dir);
+            else if (tile->ghost)
+                draw_ghost(u, v, tile->ghost - 1, ghosts_fleeing);
+            else if (!tile_empty(drawn) || !draw_sparse(tile, u, v, true))
+            {
+                if (items[c][r])
+                    items[c][r]->draw(u, v);
+                else
+                    draw_wall(u, v);
+            }
+            *drawn = *tile;
+            frame_tiles++;
         }
     }
 
+    PROFILE_STOP(PROF_TILES);
+
     // Draw status bars
-    if (Player.x != Player.px || Player.y != Player.py
-        || Player.isOmni != Player.pisOmni || Player.power != Player.ppower
-        || ghosts_fleeing % 10 == 9)
-        draw_upper_status(Player.x, Player.y, Player.isOmni, get_active_map_index(), Player.power, ghosts_fleeing, Player.questState);
+    PROFILE_START(PROF_STATUS);
+    StatusBar status = {Player.x, Player.y, Player.isOmni, get_active_map_index(),
+        Player.power, (ghosts_fleeing * TICK_MS + 999) / 1000, Player.questState};
+    if (memcmp(&status, &status_drawn, sizeof(status))) {
+        draw_upper_status(status.x, status.y, status.isOmni, status.map, status.power, status.flee_s, status.questState);
+        status_drawn = status;
+    }
     if (init)
         draw_lower_status(get_active_map_index());
+    PROFILE_STOP(PROF_STATUS);
+
+    frame_bytes = uLCD.tx_bytes - start_bytes;
+    frame_us = frame_timer.read_us();
+#if REPORT_DRAW_STATS
+    unsigned blits = uLCD.blit_count - start_blits;
+    pc.printf("draw: %d tiles, %u bytes%s, %u blits in %u us (max %u us), %u us blocked on LCD, frame %d us, %d bytes queued\r\n",
+        frame_tiles, frame_bytes, frame_pan ? ", pan" : "", blits, uLCD.blit_us - start_blit_us,
+        uLCD.blit_max_us, uLCD.tx_wait_us - start_wait_us, frame_us, uLCD.queue_depth());
+#endif
 }
 
 
@@ -396,7 +556,7 @@ void init_maps()
     {
         add_dot(i % map_width(), i / map_width());
     }
-    add_wall(0, 0, HORIZONTAL, 1);
+    // The perimeter is walled in by the map itself (see maps_init)
     //add_wall(0,              0,              HORIZONTAL, map_width());
     //add_wall(0,              map_height()-1, HORIZONTAL, map_width());
     //add_wall(0,              0,              VERTICAL,   map_height());
@@ -410,7 +570,7 @@ void init_maps()
     print_map();
 
     set_active_map(1);
-    add_wall(0, 0, HORIZONTAL, 1);
+    // The perimeter is walled in by the map itself (see maps_init)
     //add_wall(0,              0,              HORIZONTAL, map_width());
     //add_wall(0,              map_height()-1, HORIZONTAL, map_width());
     //add_wall(0,              0,              VERTICAL,   map_height());
@@ -468,6 +628,8 @@ void init_maps()
 
     pc.printf("Map 1:\r\n");
     print_map();
+    print_map_memory();
+    print_map_stats();
 }
 
 void init_powerups() {
@@ -511,38 +673,43 @@ void init_npcs(int map) {
         ghosts[2].px = 17;
         ghosts[2].py = 17;
     }
+    clear_map_occupants();
+    for (int i = 0; i < NUM_GHOSTS; i++)
+        set_map_occupant(ghosts[i].x, ghosts[i].y, i);
 }
 
+/**
+ * Ghosts follow the flow field (see flow.h) down towards the player, or up
+ * away from them while fleeing, one step at a time. Of the neighbouring cells
+ * no other ghost is on, a ghost takes the one that is nearest the player (or
+ * furthest while fleeing), and stays put if none is better than its own.
+ */
+static const int step_x[4] = {1, 0, -1, 0};
+static const int step_y[4] = {0, 1, 0, -1};
+
 void update_npcs() {
-    int dx, dy = 0;
-    int newx, newy = 0;
-    for (int i = 0; i < 3; i++) {
+    flow_update(Player.x, Player.y);
+    for (int i = 0; i < NUM_GHOSTS; i++) {
         if (ghosts[i].dead)
             continue;
         ghosts[i].px = ghosts[i].x;
         ghosts[i].py = ghosts[i].y;
-        dx = Player.x - ghosts[i].x;
-        dx = ghosts_fleeing ? -dx : dx;
-        dy = Player.y - ghosts[i].y;
-        dy = ghosts_fleeing ? -dy : dy;
-        newx = ghosts[i].x + sign(dx);
-        if (get_here(newx, ghosts[i].y) || getGhost(newx, ghosts[i].y) >= 0)
-            newx = -1;
-        newy = ghosts[i].y + sign(dy);
-        if (get_here(ghosts[i].x, newy) || getGhost(ghosts[i].x, newy) >= 0)
-            newy = -1;
-
-        if (newx >= 0 && newy < 0)
-            ghosts[i].x = newx;
-        else if (newx < 0 && newy >= 0)
-            ghosts[i].y = newy;
-        else if (newx >= 0 && newy >= 0) {
-            if (abs(dx) > abs(dy)) {
-                ghosts[i].x = newx;
-            } else {
-                ghosts[i].y = newy;
+
+        int best = -1;
+        int best_dist = flow_distance(ghosts[i].x, ghosts[i].y);
+        for (int s = 0; s < 4; s++) {
+            int x = ghosts[i].x + step_x[s];
+            int y = ghosts[i].y + step_y[s];
+            int d = flow_distance(x, y);
+            if (d == FLOW_UNREACHABLE || getGhost(x, y) >= 0)
+                continue;
+            if (ghosts_fleeing ? d > best_dist : d < best_dist) {
+                best = s;
+                best_dist = d;
             }
         }
+        if (best >= 0)
+            move_ghost(i, ghosts[i].x + step_x[best], ghosts[i].y + step_y[best]);
         
         if (ghosts[i].x == Player.x && ghosts[i].y == Player.y) {
             handle_npc_collision(i);
@@ -560,8 +727,9 @@ void handle_npc_collision(int ghost) {
         init_powerups();
     } else {
         ghosts[ghost].dead = 1;
+        set_map_occupant(ghosts[ghost].x, ghosts[ghost].y, NO_OCCUPANT);
         int anyAlive = 0;
-        for (int i = 0; i < 3; i++) {
+        for (int i = 0; i < NUM_GHOSTS; i++) {
             if (!ghosts[i].dead)
                 anyAlive = 1;
         }
@@ -573,10 +741,117 @@ void handle_npc_collision(int ghost) {
     draw_game(1);
 }
 
-int sign(int x) {
-    return (x > 0) - (x < 0);
+/**
+ * FNV-1a hash of the player and ghost state, to check that a replayed session
+ * plays out exactly as its recording did (see RECORD_INPUTS in globals.h).
+ */
+static unsigned int hash_bytes(unsigned int h, const void* data, int size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (int i = 0; i < size; i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+static unsigned int state_checksum()
+{
+    int map = get_active_map_index();
+    unsigned int h = 2166136261u;
+    h = hash_bytes(h, &Player, sizeof(Player));
+    h = hash_bytes(h, ghosts, sizeof(ghosts));
+    h = hash_bytes(h, &ghosts_fleeing, sizeof(ghosts_fleeing));
+    return hash_bytes(h, &map, sizeof(map));
+}
+
+#if RUN_BENCHMARKS
+/**
+ * Count the CPU cycles of reading the tilt and deciding a move from it, the
+ * way it is done now (read_inputs() and get_action(), in counts) and the way
+ * it was done before GameInputs held counts (readXYZGravity() over I2C, then
+ * comparing doubles). The decision alone is timed both ways too. The counter
+ * is the Cortex-M3's DWT cycle counter, which the host build lacks.
+ */
+#define BENCH_PASSES 1000
+
+#ifdef DWT
+static int tilt_move_in_g(double ax, double ay)
+{
+    if (fabs(ax) > fabs(ay)) {
+        if (ax < -0.2) return GO_LEFT;
+        if (ax > 0.2) return GO_RIGHT;
+    } else {
+        if (ay < -0.2) return GO_DOWN;
+        if (ay > 0.2) return GO_UP;
+    }
+    return NO_ACTION;
 }
 
+/**
+ * The old input path. The data-ready interrupt reads the accelerometer too,
+ * so it is held off while this shares the I2C bus.
+ */
+static int read_tilt_move_in_g()
+{
+    double ax, ay, az;
+    __disable_irq();
+    acc.readXYZGravity(&ax, &ay, &az);
+    __enable_irq();
+    return tilt_move_in_g(ax, ay);
+}
+#endif
+
+static void benchmark_inputs()
+{
+#ifdef DWT
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    // Volatile, so the compiler cannot fold the tilt into constants
+    volatile int ax = TILT_COUNTS_PER_G / 4, ay = -TILT_COUNTS_PER_G / 8;
+    volatile int sink;
+    GameInputs in = {0, 0, 0, 0, 0, 0, TILT_COUNTS_PER_G};
+
+    unsigned int start = DWT->CYCCNT;
+    for (int i = 0; i < BENCH_PASSES; i++) {
+        in.ax = ax;
+        in.ay = ay;
+        sink = get_action(in);
+    }
+    unsigned int counts = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    for (int i = 0; i < BENCH_PASSES; i++)
+        sink = tilt_move_in_g(ax / (double)TILT_COUNTS_PER_G, ay / (double)TILT_COUNTS_PER_G);
+    unsigned int doubles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    for (int i = 0; i < BENCH_PASSES; i++)
+        sink = read_tilt_move_in_g();
+    unsigned int old_pass = DWT->CYCCNT - start;
+
+    // Every read is logged or replayed when recording or replaying
+    unsigned int pass = 0;
+#if !RECORD_INPUTS && !REPLAY_INPUTS
+    start = DWT->CYCCNT;
+    for (int i = 0; i < BENCH_PASSES; i++)
+        sink = get_action(read_inputs());
+    pass = DWT->CYCCNT - start;
+#endif
+    (void)sink;
+    tilt_move = NO_ACTION;
+
+    pc.printf("Input benchmark (CPU cycles, mean of %d):\r\n", BENCH_PASSES);
+    pc.printf("  read and decide in counts (read_inputs + get_action): %u\r\n", pass / BENCH_PASSES);
+    pc.printf("  read and decide in doubles (readXYZGravity): %u\r\n", old_pass / BENCH_PASSES);
+    pc.printf("  decide in counts: %u, in doubles: %u\r\n",
+              counts / BENCH_PASSES, doubles / BENCH_PASSES);
+#else
+    pc.printf("Input benchmark: no cycle counter on this build\r\n");
+#endif
+}
+#endif
+
 /**
  * Program entry point! This is where it all begins.
  * This function orchestrates all the parts of the game. Most of your
@@ -591,7 +866,13 @@ int main()
     // Initialize the maps
     maps_init();
     init_maps();
-    init_sprites();
+#if CHECK_MAP_LOOKUPS
+    check_map_lookups();
+#endif
+#if RUN_BENCHMARKS
+    benchmark_map_tables();
+    benchmark_inputs();
+#endif
 
     // Initialize game state
     set_active_map(0);
@@ -602,41 +883,84 @@ int main()
     // Initial drawing
     draw_game(true);
 
-    int loop_cntr = 0;
+    // Simulation clock: the tick count, and how far the simulation lags real
+    // time. The timer only measures time since lag_us last took it in, and
+    // is reset then, so it never runs long enough to wrap.
+    int tick = 0;
+    int lag_us = TICK_MS * 1000;
+    Timer game_clock; game_clock.start();
 
     // Main game loop
     while(1)
     {
-        // Timer to measure game update speed
-        Timer t; t.start(); // Does t need to be declared inside loop?
-
-        // Actuall do the game update:
+        // Run the ticks that are due:
         // 1. Read inputs
         // 2. Determine action (get_action)
         // 3. Update game (update_game)
         // 3b. Check for game over
-        // 4. Draw frame (draw_game)
-        GameInputs inputs = read_inputs();
-        int action = get_action(inputs);
-        int result = update_game(action);
+        PROFILE_START(PROF_FRAME);
+        int result = NO_RESULT;
+        lag_us += game_clock.read_us();
+        game_clock.reset();
+        for (int ticks = 0; ticks < MAX_CATCH_UP && lag_us >= TICK_MS * 1000; ticks++)
+        {
+            int tick_start = game_clock.read_us();
+            PROFILE_START(PROF_INPUTS);
+            GameInputs inputs = read_inputs();
+            PROFILE_STOP(PROF_INPUTS);
+            PROFILE_START(PROF_ACTION);
+            int action = get_action(inputs);
+            PROFILE_STOP(PROF_ACTION);
+            PROFILE_START(PROF_UPDATE);
+            int tick_result = update_game(action);
+            PROFILE_STOP(PROF_UPDATE);
+            if (result != GAME_OVER && tick_result != NO_RESULT)
+                result = tick_result;
+
+            if (ghosts_fleeing)
+                ghosts_fleeing--;
+            // Follow the player every tick, so that the ghosts' flow field is
+            // repaired a step at a time rather than searched again
+            if (get_active_map_index() == 1)
+                flow_update(Player.x, Player.y);
+            if (get_active_map_index() == 1 && tick % GHOST_STEP_TICKS == 0) {
+                PROFILE_START(PROF_NPCS);
+                update_npcs();
+                PROFILE_STOP(PROF_NPCS);
+            }
+            log_state(state_checksum());
 
-        if (ghosts_fleeing)
-            ghosts_fleeing--;
-        if (get_active_map_index() == 1 && loop_cntr == 0)
-            update_npcs();
+            tick++;
+            lag_us -= TICK_MS * 1000;
+            if (game_clock.read_us() - tick_start > STALL_MS * 1000) {
+                lag_us = 0;
+                game_clock.reset();
+            }
+            if (result == GAME_OVER)
+                break;
+        }
+        if (lag_us + game_clock.read_us() > MAX_CATCH_UP * TICK_MS * 1000) {
+            lag_us = 0;
+            game_clock.reset();
+        }
 
+        // 4. Draw frame (draw_game), showing every tick run since the last one
+        PROFILE_START(PROF_DRAW);
         draw_game(result);
+        PROFILE_STOP(PROF_DRAW);
         if (result == GAME_OVER)
             break;
 
-        loop_cntr++;
-        if (loop_cntr > 2)
-            loop_cntr = 0;
-
-        // 5. Frame delay
-        t.stop();
-        int dt = t.read_ms();
-        if (dt < 100) wait_ms(100 - dt); // Could we set frame time shorter than 100 ms?
+        // 5. Sleep until the next tick. The LCD keeps drawing meanwhile, and
+        // a frame drawn before then would show nothing new.
+        PROFILE_STOP(PROF_FRAME);
+        PROFILE_FRAME_DONE();
+        int dt = TICK_MS * 1000 - (lag_us + game_clock.read_us());
+        if (dt > 0) wait_us(dt);
     }
     draw_game_over();
+    log_inputs_done();
+#if REPORT_FLOW_STATS
+    flow_report();
+#endif
 }
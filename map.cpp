@@ -2,22 +2,66 @@
 
 #include "globals.h"
 #include "graphics.h"
+#include <string.h>
 
 /**
- * The Map structure. This holds a HashTable for all the MapItems, along with
- * values for the width and height of the Map.
+ * Backing stores for the MapItems of a Map.
+ * MAP_STORE_HASH keeps them in a chained HashTable keyed by XY_KEY.
+ * MAP_STORE_GRID keeps a row-major array with a one-byte item id per cell,
+ * indexing into a compact table of MapItem pointers (id 0 means empty).
+ */
+#define MAP_STORE_HASH 0
+#define MAP_STORE_GRID 1
+
+// Largest number of items a grid store can hold (ids are one byte, 0 is empty)
+#define GRID_MAX_ITEMS 255
+// Number of slots the grid store's item table grows by when it fills up
+#define GRID_TABLE_STEP 16
+
+/**
+ * The only MapItems not shared as prototypes are portals, which are allocated
+ * with their PortalData from one pool per map, so the blocks have to fit the
+ * larger of the two.
+ */
+#define MAP_BLOCK_SIZE (sizeof(MapItem) > sizeof(PortalData) ? sizeof(MapItem) : sizeof(PortalData))
+// Number of blocks a map's pool takes from the heap at once: one portal
+#define MAP_POOL_SLAB 2
+
+/**
+ * The Map structure. This holds the MapItems in one of the backing stores above,
+ * along with values for the width and height of the Map.
  */
 struct Map {
-    HashTable* items;
+    int store;              // MAP_STORE_HASH or MAP_STORE_GRID
+    HashTable* items;       // Hash store: all MapItems, keyed by XY_KEY
+    unsigned char* cells;   // Grid store: item id for each XY_KEY
+    MapItem** table;        // Grid store: MapItem for each id (at index id-1)
+    int table_size;         // Grid store: allocated length of table
+    Pool* pool;             // Portals and their PortalData
+    MapItem* border;        // Item on every perimeter cell not in edge_set
+    unsigned char* edge_set; // Bit per perimeter cell that holds its own item
+    unsigned* walkable;     // Bit per cell the player can step on
+    unsigned* empty;        // Bit per cell with no item
+    int num_buckets;
+    int num_items;
     int w, h;
 };
 
+/**
+ * Each map uses the store print_map_memory reports as smaller on the LPC1768,
+ * where pointers are 4 bytes. The main map's 113 items take about 2.1 KB in
+ * the hash store, against 2.6 KB for a grid of its 2500 cells. The quest map
+ * packs 133 items into 529 cells, which take about 0.6 KB as a grid and
+ * 2.3 KB hashed.
+ */
 #define MAIN_MAP_WIDTH    50
 #define MAIN_MAP_HEIGHT   50
 #define MAIN_MAP_BUCKETS 100
+#define MAIN_MAP_STORE   MAP_STORE_HASH
 #define QUEST_MAP_WIDTH   23
 #define QUEST_MAP_HEIGHT  23
 #define QUEST_MAP_BUCKETS 50
+#define QUEST_MAP_STORE  MAP_STORE_GRID
 
 /**
  * Storage area for the maps.
@@ -27,43 +71,435 @@ struct Map {
 static Map map[2];
 static int active_map;
 
+static MapListener listeners[MAX_MAP_LISTENERS];
+static int num_listeners;
+
+/**
+ * The occupancy layer: id + 1 of the entity on each cell of the active map,
+ * or 0. It grows to fit the largest map it has been cleared for.
+ */
+static unsigned char* occupants;
+static int occupant_cells;
+
+/**
+ * Shared, immutable MapItems for the types that carry no per-instance data,
+ * indexed by type. Every cell holding one of these types points at the same
+ * prototype, so they take no heap and are never freed. Portals carry their
+ * own PortalData and are allocated individually; their entry here is unused.
+ */
+static const MapItem prototypes[] = {
+    {WALL,   draw_wall,   false, NULL},
+    {DOT,    draw_dot,    true,  NULL},
+    {TREE,   draw_tree,   true,  NULL},
+    {PORTAL, draw_portal, false, NULL},
+    {PRIZE,  draw_prize,  true,  NULL},
+    {DOOR,   draw_door,   false, NULL},
+};
+
+/**
+ * Returns the shared prototype for a MapItem type.
+ */
+static MapItem* prototype(int type)
+{
+    // The map only hands out non-const MapItems, but nothing writes to them
+    return (MapItem*) &prototypes[type];
+}
+
+/**
+ * Returns true if item is one of the shared prototypes.
+ */
+static bool is_prototype(const MapItem* item)
+{
+    return item >= prototypes && item < prototypes + sizeof(prototypes) / sizeof(MapItem);
+}
+
 /**
  * The first step in HashTable access for the map is turning the two-dimensional
  * key information (x, y) into a one-dimensional unsigned integer.
  * This function should uniquely map (x,y) onto the space of unsigned integers.
+ * Only meaningful for (x, y) inside the map.
  */
 static unsigned XY_KEY(int X, int Y) {
-    // Fold wall coordinates to same key for memory savings
-    if (X == 0 || X == map_width() - 1 || Y == 0 || Y == map_height() - 1)
-        return 0;
     return Y * map_width() + X;
 }
 
+/**
+ * Returns true if (x, y) is on the perimeter of map m.
+ */
+static bool on_edge(Map* m, int x, int y)
+{
+    return x == 0 || y == 0 || x == m->w - 1 || y == m->h - 1;
+}
+
+/**
+ * Returns the index of perimeter cell (x, y) of map m in its edge_set: the top
+ * row, then the bottom row, then the left and right columns without corners.
+ */
+static int edge_index(Map* m, int x, int y)
+{
+    if (y == 0) return x;
+    if (y == m->h - 1) return m->w + x;
+    if (x == 0) return 2 * m->w + y - 1;
+    return 2 * m->w + m->h - 2 + y - 1;
+}
+
+/**
+ * Returns true if perimeter cell (x, y) of map m holds its own item (or has
+ * been erased) instead of showing the map's border item.
+ */
+static bool edge_overridden(Map* m, int x, int y)
+{
+    int i = edge_index(m, x, y);
+    return m->edge_set[i / 8] & (1 << (i % 8));
+}
+
+/**
+ * Make perimeter cell (x, y) of map m hold its own item from now on. Does
+ * nothing for cells inside the perimeter.
+ */
+static void override_edge(Map* m, int x, int y)
+{
+    if (!on_edge(m, x, y))
+        return;
+    int i = edge_index(m, x, y);
+    m->edge_set[i / 8] |= 1 << (i % 8);
+}
+
+/**
+ * Words in each bit plane of map m: a bit per cell, and a spare word so that
+ * a row can always be read as two whole words.
+ */
+static int plane_words(Map* m)
+{
+    return (m->w * m->h + 31) / 32 + 1;
+}
+
+static void set_bit(unsigned* plane, int i, bool value)
+{
+    if (value)
+        plane[i / 32] |= 1u << (i % 32);
+    else
+        plane[i / 32] &= ~(1u << (i % 32));
+}
+
+/**
+ * Allocate the bit planes of map m, with every cell empty except the border
+ * wall on the perimeter.
+ */
+static void map_init_bits(Map* m)
+{
+    int words = plane_words(m);
+    m->walkable = (unsigned*) malloc(words * sizeof(unsigned));
+    m->empty = (unsigned*) malloc(words * sizeof(unsigned));
+    if (!m->walkable || !m->empty) {
+        pc.printf("OUT OF MEMORY");
+        return;
+    }
+    memset(m->walkable, 0xFF, words * sizeof(unsigned));
+    memset(m->empty, 0xFF, words * sizeof(unsigned));
+    for (int y = 0; y < m->h; y++) {
+        for (int x = 0; x < m->w; x++) {
+            if (on_edge(m, x, y)) {
+                set_bit(m->walkable, y * m->w + x, m->border->walkable);
+                set_bit(m->empty, y * m->w + x, false);
+            }
+        }
+    }
+}
+
+/**
+ * Set the bits of cell (x, y) of map m for item, which may be NULL.
+ */
+static void set_cell_bits(Map* m, int x, int y, MapItem* item)
+{
+    if (!m->walkable || !m->empty)
+        return;
+    set_bit(m->walkable, y * m->w + x, !item || item->walkable);
+    set_bit(m->empty, y * m->w + x, !item);
+}
+
+/**
+ * Returns the bits of plane for the n (at most 32) cells from (x, y) to
+ * (x+n-1, y) of map m, cell x in bit 0. Cells outside the map read as 1.
+ */
+static unsigned plane_row(Map* m, const unsigned* plane, int x, int y, int n)
+{
+    unsigned all = n >= 32 ? ~0u : (1u << n) - 1;
+    if (!plane || y < 0 || y >= m->h || x >= m->w || x + n <= 0)
+        return all;
+
+    // Start the window at the left edge if it begins outside the map
+    int skip = x < 0 ? -x : 0;
+    unsigned i = y * m->w + x + skip;
+    unsigned bits = plane[i / 32] >> (i % 32);
+    if (i % 32)
+        bits |= plane[i / 32 + 1] << (32 - i % 32);
+    bits = (bits << skip) | ((1u << skip) - 1);
+
+    // Past the right edge the window runs on into the next row
+    int inside = m->w - x;
+    if (inside < n)
+        bits |= ~((1u << inside) - 1);
+    return bits & all;
+}
+
+/**
+ * Returns the bits of plane for the 3x3 cells of map m centred on (x, y).
+ */
+static unsigned plane_around(Map* m, const unsigned* plane, int x, int y)
+{
+    return plane_row(m, plane, x - 1, y - 1, 3)
+        | plane_row(m, plane, x - 1, y, 3) << 3
+        | plane_row(m, plane, x - 1, y + 1, 3) << 6;
+}
+
 /**
  * This is the hash function actually passed into createHashTable. It takes an
- * unsigned key (the output of XY_KEY) and turns it into a hash value (some
- * small non-negative integer).
+ * unsigned key (the output of XY_KEY) and turns it into a hash value. The
+ * table takes the hash modulo its current number of buckets itself, so the
+ * hash keeps the full key range and stays valid after the table grows.
  */
 unsigned main_map_hash(unsigned key)
 {
-    return key % MAIN_MAP_BUCKETS;
+    return key;
 }
 unsigned quest_map_hash(unsigned key)
 {
-    return key % QUEST_MAP_BUCKETS;
+    return key;
+}
+
+/**
+ * Set up the backing store for map m. The hash store allocates its HashTable
+ * up front; the grid store allocates one byte per cell and grows its item
+ * table as items are added. Either way portals come from the map's pool.
+ */
+static void map_init_store(Map* m, int store, HashFunction hash, int buckets)
+{
+    // Every map is walled in. The perimeter cells are answered without
+    // touching the store until something is put on them.
+    m->border = prototype(WALL);
+    m->edge_set = (unsigned char*) calloc((2 * m->w + 2 * m->h - 4 + 7) / 8, sizeof(unsigned char));
+    if (!m->edge_set)
+        pc.printf("OUT OF MEMORY");
+    map_init_bits(m);
+    m->store = store;
+    m->num_buckets = buckets;
+    m->num_items = 0;
+    m->items = NULL;
+    m->cells = NULL;
+    m->table = NULL;
+    m->table_size = 0;
+    m->pool = createPool(MAP_BLOCK_SIZE, MAP_POOL_SLAB);
+    if (store == MAP_STORE_HASH) {
+        m->items = createHashTable(hash, buckets);
+        setHashTableValuePool(m->items, m->pool);
+        setHashTableSharedValues(m->items, prototypes, sizeof(prototypes));
+    } else {
+        m->cells = (unsigned char*) calloc(m->w * m->h, sizeof(unsigned char));
+        if (!m->cells)
+            pc.printf("OUT OF MEMORY");
+    }
 }
 
 void maps_init()
 {
-    map[0].items = createHashTable(main_map_hash, MAIN_MAP_BUCKETS);
     map[0].w = MAIN_MAP_WIDTH;
     map[0].h = MAIN_MAP_HEIGHT;
-    map[1].items = createHashTable(quest_map_hash, QUEST_MAP_BUCKETS);
+    map_init_store(&map[0], MAIN_MAP_STORE, main_map_hash, MAIN_MAP_BUCKETS);
     map[1].w = QUEST_MAP_WIDTH;
     map[1].h = QUEST_MAP_HEIGHT;
+    map_init_store(&map[1], QUEST_MAP_STORE, quest_map_hash, QUEST_MAP_BUCKETS);
     active_map = 0;
 }
 
+/**
+ * Look up the MapItem stored under key in map m, or NULL if there is none.
+ */
+static MapItem* map_lookup(Map* m, unsigned key)
+{
+    if (m->store == MAP_STORE_HASH)
+        return (MapItem*) getItem(m->items, key);
+
+    if (key >= (unsigned)(m->w * m->h))
+        return NULL;
+    unsigned char id = m->cells[key];
+    return id ? m->table[id - 1] : NULL;
+}
+
+/**
+ * Find an unused id in the grid store of map m, growing the item table if
+ * every slot is taken. Returns 0 if the store is full.
+ *
+ * Prototype ids are shared by every cell holding that prototype, so their
+ * slots are never released once taken.
+ */
+static unsigned char grid_new_id(Map* m)
+{
+    for (int i = 0; i < m->table_size; i++) {
+        if (!m->table[i])
+            return i + 1;
+    }
+    if (m->table_size == GRID_MAX_ITEMS)
+        return 0;
+
+    int size = m->table_size + GRID_TABLE_STEP;
+    if (size > GRID_MAX_ITEMS)
+        size = GRID_MAX_ITEMS;
+    MapItem** table = (MapItem**) realloc(m->table, size * sizeof(MapItem*));
+    if (!table) {
+        pc.printf("OUT OF MEMORY");
+        return 0;
+    }
+    for (int i = m->table_size; i < size; i++)
+        table[i] = NULL;
+    int id = m->table_size + 1;
+    m->table = table;
+    m->table_size = size;
+    return id;
+}
+
+/**
+ * Find the id of item in the grid store of map m, giving it a new id unless it
+ * is a prototype that already has one. Returns 0 if the store is full.
+ */
+static unsigned char grid_item_id(Map* m, MapItem* item)
+{
+    if (is_prototype(item)) {
+        for (int i = 0; i < m->table_size; i++) {
+            if (m->table[i] == item)
+                return i + 1;
+        }
+    }
+    unsigned char id = grid_new_id(m);
+    if (id)
+        m->table[id - 1] = item;
+    return id;
+}
+
+/**
+ * Store item under key in map m. Returns the MapItem that was there before,
+ * or NULL if the cell was empty.
+ */
+static MapItem* map_insert(Map* m, unsigned key, MapItem* item)
+{
+    MapItem* old;
+    if (m->store == MAP_STORE_HASH) {
+        old = (MapItem*) insertItem(m->items, key, item);
+    } else {
+        if (key >= (unsigned)(m->w * m->h)) {
+            pc.printf("OUT OF BOUNDS");
+            return item;
+        }
+        unsigned char old_id = m->cells[key];
+        old = old_id ? m->table[old_id - 1] : NULL;
+        // Release the slot of the item being replaced, so item can reuse it
+        if (old && !is_prototype(old))
+            m->table[old_id - 1] = NULL;
+        unsigned char id = grid_item_id(m, item);
+        if (!id) {
+            if (old)
+                m->table[old_id - 1] = old;
+            pc.printf("GRID FULL");
+            return item;
+        }
+        m->cells[key] = id;
+    }
+    if (!old)
+        m->num_items++;
+    return old;
+}
+
+/**
+ * Remove the MapItem stored under key in map m and return it, or NULL if the
+ * cell was empty. The MapItem itself is not freed.
+ */
+static MapItem* map_remove(Map* m, unsigned key)
+{
+    MapItem* old;
+    if (m->store == MAP_STORE_HASH) {
+        old = (MapItem*) removeItem(m->items, key);
+    } else {
+        if (key >= (unsigned)(m->w * m->h))
+            return NULL;
+        unsigned char id = m->cells[key];
+        if (!id)
+            return NULL;
+        old = m->table[id - 1];
+        if (!is_prototype(old))
+            m->table[id - 1] = NULL;
+        m->cells[key] = 0;
+    }
+    if (old)
+        m->num_items--;
+    return old;
+}
+
+/**
+ * Allocate an uninitialized MapItem (or MapItem data) from the pool of map m.
+ */
+static void* new_map_block(Map* m)
+{
+    void* block = poolAlloc(m->pool);
+    if (!block)
+        pc.printf("OUT OF MEMORY");
+    return block;
+}
+
+/**
+ * Free a MapItem that has been taken out of map m, along with its data.
+ * Shared prototypes are left alone.
+ */
+static void free_map_item(Map* m, MapItem* item)
+{
+    if (!item || is_prototype(item))
+        return;
+    poolFree(m->pool, item->data);
+    poolFree(m->pool, item);
+}
+
+/**
+ * Returns true if (x, y) is inside map m.
+ */
+static bool in_bounds(Map* m, int x, int y)
+{
+    return x >= 0 && y >= 0 && x < m->w && y < m->h;
+}
+
+void add_map_listener(MapListener listener)
+{
+    if (num_listeners == MAX_MAP_LISTENERS) {
+        pc.printf("TOO MANY MAP LISTENERS");
+        return;
+    }
+    listeners[num_listeners++] = listener;
+}
+
+static void map_changed(int x, int y)
+{
+    for (int i = 0; i < num_listeners; i++)
+        listeners[i](x, y);
+}
+
+/**
+ * Put item at (x, y) on the active map, freeing whatever was there. Items
+ * outside the map are dropped.
+ */
+static void set_here(int x, int y, MapItem* item)
+{
+    Map* m = get_active_map();
+    if (!in_bounds(m, x, y)) {
+        pc.printf("OUT OF BOUNDS");
+        free_map_item(m, item);
+        return;
+    }
+    override_edge(m, x, y);
+    MapItem* val = map_insert(m, XY_KEY(x, y), item);
+    free_map_item(m, val); // If something was already there, free it
+    // The insert can fail, so set the bits from what the cell holds now
+    set_cell_bits(m, x, y, map_lookup(m, XY_KEY(x, y)));
+    map_changed(x, y);
+}
+
 Map* get_active_map()
 {
     return &(map[active_map]);
@@ -95,6 +531,236 @@ void print_map()
     }
 }
 
+/**
+ * Estimate the item table a grid store would need for map m: an id for each
+ * prototype in use, shared by all its cells, and one for every other item,
+ * rounded up to the GRID_TABLE_STEP slots the table grows by.
+ */
+static int grid_slots_needed(Map* m)
+{
+    bool used[sizeof(prototypes) / sizeof(MapItem)] = {false};
+    int ids = 0;
+    for (int key = 0; key < m->w * m->h; key++) {
+        MapItem* item = map_lookup(m, key);
+        if (!item)
+            continue;
+        if (!is_prototype(item))
+            ids++;
+        else if (!used[item - prototypes]) {
+            used[item - prototypes] = true;
+            ids++;
+        }
+    }
+    return (ids + GRID_TABLE_STEP - 1) / GRID_TABLE_STEP * GRID_TABLE_STEP;
+}
+
+void print_map_memory()
+{
+    for (int i = 0; i < 2; i++) {
+        Map* m = &map[i];
+        int area = m->w * m->h;
+        // Estimate the hash store from the item count unless this map uses it
+        unsigned hash = (m->store == MAP_STORE_HASH) ? getHashTableBytes(m->items)
+                        : hashTableFootprint(m->num_buckets, m->num_items);
+        int slots = (m->store == MAP_STORE_GRID) ? m->table_size : grid_slots_needed(m);
+        unsigned grid = area * sizeof(unsigned char) + slots * sizeof(MapItem*);
+        // Prototype items are shared and live outside the heap
+        PoolStats items_pool, entry_pool;
+        getPoolStats(m->pool, &items_pool);
+        unsigned items = items_pool.slab_bytes;
+        unsigned bits = 2 * plane_words(m) * sizeof(unsigned);
+        pc.printf("Map %d (%dx%d, %d items, %s store): hash %u B, grid %u B, items %u B, bit planes %u B\r\n",
+                  i, m->w, m->h, m->num_items, m->store == MAP_STORE_GRID ? "grid" : "hash",
+                  hash, grid, items, bits);
+
+        pc.printf("  item pool: %u live, %u high water, %u B slabs, %d B saved\r\n",
+                  items_pool.live, items_pool.high_water, items_pool.slab_bytes,
+                  items_pool.bytes_saved);
+        if (m->store == MAP_STORE_HASH) {
+            getHashTablePoolStats(m->items, &entry_pool);
+            pc.printf("  entry pool: %u live, %u high water, %u B slabs, %d B saved\r\n",
+                      entry_pool.live, entry_pool.high_water, entry_pool.slab_bytes,
+                      entry_pool.bytes_saved);
+        }
+    }
+}
+
+void print_map_stats()
+{
+    for (int i = 0; i < 2; i++) {
+        Map* m = &map[i];
+        if (m->store != MAP_STORE_HASH) continue;
+        HashTableStats stats;
+        getHashTableStats(m->items, &stats);
+        // Load factor and mean probes in hundredths, printf has no %f here
+        pc.printf("Map %d hash: %u entries, %u buckets, load %u.%02u, longest chain %u, "
+                  "mean probes %u.%02u%s\r\n", i, stats.num_entries, stats.num_buckets,
+                  stats.num_entries / stats.num_buckets,
+                  stats.num_entries * 100 / stats.num_buckets % 100, stats.longest_chain,
+                  stats.num_entries ? stats.total_probes / stats.num_entries : 0,
+                  stats.num_entries ? stats.total_probes * 100 / stats.num_entries % 100 : 0,
+                  stats.resizing ? " (resizing)" : "");
+        pc.printf("  chain lengths:");
+        for (int b = 0; b < HASH_STATS_BINS; b++)
+            pc.printf(" %d%s:%u", b, b == HASH_STATS_BINS - 1 ? "+" : "", stats.histogram[b]);
+        pc.printf("\r\n");
+    }
+}
+
+/**
+ * The answer get_here gave before perimeter cells had keys of their own:
+ * XY_KEY folded every perimeter cell onto key 0, which held the border wall,
+ * and nothing was ever stored under the keys of perimeter cells. The fold
+ * also caught out of range coordinates in line with a perimeter row or column
+ * (e.g. (0, -1)); other out of range coordinates came back empty.
+ */
+static MapItem* legacy_get_here(Map* m, int x, int y)
+{
+    if (x == 0 || x == m->w - 1 || y == 0 || y == m->h - 1)
+        return m->border;
+    unsigned key = y * m->w + x;
+    if (key >= (unsigned)(m->w * m->h) || on_edge(m, key % m->w, key / m->w))
+        return NULL;
+    return map_lookup(m, key);
+}
+
+int check_map_lookups()
+{
+    int prev_map = active_map;
+    int failures = 0;
+    for (int i = 0; i < 2; i++) {
+        Map* m = set_active_map(i);
+        int cells = 0, edge_items = 0, folded = 0, mismatches = 0;
+        // Include a ring of cells just outside the map
+        for (int y = -1; y <= m->h; y++) {
+            for (int x = -1; x <= m->w; x++) {
+                MapItem* expected = legacy_get_here(m, x, y);
+                if (!in_bounds(m, x, y)) {
+                    // Outside the map is always empty now
+                    if (expected)
+                        folded++;
+                    expected = NULL;
+                } else if (on_edge(m, x, y) && edge_overridden(m, x, y)) {
+                    // Items put on the perimeter are new behavior, the old
+                    // lookup would have returned the border for them
+                    edge_items++;
+                    continue;
+                }
+                cells++;
+                if (get_here(x, y) != expected) {
+                    if (!mismatches)
+                        pc.printf("Map %d lookup mismatch at (%d, %d)\r\n", i, x, y);
+                    mismatches++;
+                }
+            }
+        }
+        // The bit planes have to agree with the items, cell by cell and a
+        // row or a neighbourhood at a time
+        for (int y = -1; y <= m->h; y++) {
+            for (int x = -1; x <= m->w; x++) {
+                MapItem* item = get_here(x, y);
+                unsigned walkable = !item || item->walkable;
+                unsigned empty = !item;
+                unsigned around = AROUND_BIT(0, 0);
+                if (map_walkable(x, y) != (int) walkable || map_empty(x, y) != (int) empty
+                        || !(map_walkable_row(x - 5, y, 11) & (1 << 5)) != !walkable
+                        || !(map_empty_row(x - 31, y, 32) & (1u << 31)) != !empty
+                        || !(map_walkable_around(x, y) & around) != !walkable
+                        || !(map_empty_around(x + 1, y - 1) & AROUND_BIT(-1, 1)) != !empty) {
+                    if (!mismatches)
+                        pc.printf("Map %d bits mismatch at (%d, %d)\r\n", i, x, y);
+                    mismatches++;
+                }
+            }
+        }
+        pc.printf("Map %d lookups: %d cells checked, %d edge items skipped, "
+                  "%d out of range walls fixed, %d mismatches\r\n",
+                  i, cells, edge_items, folded, mismatches);
+        failures += mismatches;
+    }
+    set_active_map(prev_map);
+    return failures;
+}
+
+/**
+ * Number of times each benchmark pass over a map's keys is repeated, so the
+ * totals are well above the Timer's microsecond resolution.
+ */
+#define BENCH_ROUNDS 20
+
+/**
+ * Hash function for the open addressing benchmark tables. Those tables spread
+ * the hash over all their slots themselves, so the key can be used as is.
+ */
+static unsigned identity_hash(unsigned key)
+{
+    return key;
+}
+
+/**
+ * Insert, look up and remove every key in keys on table, BENCH_ROUNDS times,
+ * and print the average latency of each operation along with the heap bytes
+ * the table uses while it holds all the keys.
+ */
+static void bench_table(const char* name, HashTable* table, unsigned* keys, int n)
+{
+    Timer t;
+    int insert_us = 0, lookup_us = 0, erase_us = 0;
+    unsigned bytes = 0;
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        // The values are never dereferenced, any non-NULL pointer will do
+        t.reset(); t.start();
+        for (int i = 0; i < n; i++)
+            insertItem(table, keys[i], &keys[i]);
+        t.stop(); insert_us += t.read_us();
+
+        bytes = getHashTableBytes(table);
+
+        t.reset(); t.start();
+        for (int i = 0; i < n; i++)
+            getItem(table, keys[i]);
+        t.stop(); lookup_us += t.read_us();
+
+        t.reset(); t.start();
+        for (int i = 0; i < n; i++)
+            removeItem(table, keys[i]);
+        t.stop(); erase_us += t.read_us();
+    }
+    int ops = n * BENCH_ROUNDS;
+    pc.printf("  %s: insert %d ns, lookup %d ns, erase %d ns, %u B\r\n", name,
+              insert_us * 1000 / ops, lookup_us * 1000 / ops, erase_us * 1000 / ops, bytes);
+}
+
+void benchmark_map_tables()
+{
+    int prev_map = active_map;
+    HashFunction hashes[2] = {main_map_hash, quest_map_hash};
+    for (int m = 0; m < 2; m++) {
+        // Collect the keys actually used by this map
+        set_active_map(m);
+        unsigned* keys = (unsigned*) malloc(map[m].num_items * sizeof(unsigned));
+        if (!keys) {
+            pc.printf("OUT OF MEMORY");
+            break;
+        }
+        int n = 0;
+        for (unsigned key = 0; key < (unsigned) map_area() && n < map[m].num_items; key++) {
+            if (map_lookup(&map[m], key))
+                keys[n++] = key;
+        }
+
+        pc.printf("Map %d hash table benchmark (%d keys):\r\n", m, n);
+        HashTable* table = createHashTableOfType(hashes[m], map[m].num_buckets, HASH_CHAINED);
+        bench_table("chained", table, keys, n);
+        destroyHashTable(table);
+        table = createHashTableOfType(identity_hash, map[m].num_buckets, HASH_OPEN);
+        bench_table("open   ", table, keys, n);
+        destroyHashTable(table);
+        free(keys);
+    }
+    set_active_map(prev_map);
+}
+
 int map_width()
 {
     return get_active_map()->w;
@@ -132,101 +798,148 @@ MapItem* get_west(int x, int y)
 
 MapItem* get_here(int x, int y)
 {
-    return (MapItem*) getItem(get_active_map()->items, XY_KEY(x, y));
+    Map* m = get_active_map();
+    // Nothing is outside the map, and the perimeter shows the border item
+    // unless something was put there; neither needs a probe of the store
+    if (!in_bounds(m, x, y))
+        return NULL;
+    if (on_edge(m, x, y) && !edge_overridden(m, x, y))
+        return m->border;
+    return map_lookup(m, XY_KEY(x, y));
+}
+
+int map_walkable(int x, int y)
+{
+    Map* m = get_active_map();
+    if (!in_bounds(m, x, y) || !m->walkable)
+        return 1;
+    unsigned i = XY_KEY(x, y);
+    return (m->walkable[i / 32] >> (i % 32)) & 1;
+}
+
+int map_empty(int x, int y)
+{
+    Map* m = get_active_map();
+    if (!in_bounds(m, x, y) || !m->empty)
+        return 1;
+    unsigned i = XY_KEY(x, y);
+    return (m->empty[i / 32] >> (i % 32)) & 1;
+}
+
+unsigned map_walkable_row(int x, int y, int n)
+{
+    Map* m = get_active_map();
+    return plane_row(m, m->walkable, x, y, n);
+}
+
+unsigned map_empty_row(int x, int y, int n)
+{
+    Map* m = get_active_map();
+    return plane_row(m, m->empty, x, y, n);
+}
+
+unsigned map_walkable_around(int x, int y)
+{
+    Map* m = get_active_map();
+    return plane_around(m, m->walkable, x, y);
+}
+
+unsigned map_empty_around(int x, int y)
+{
+    Map* m = get_active_map();
+    return plane_around(m, m->empty, x, y);
+}
+
+int map_occupant(int x, int y)
+{
+    Map* m = get_active_map();
+    if (!in_bounds(m, x, y) || XY_KEY(x, y) >= (unsigned) occupant_cells)
+        return NO_OCCUPANT;
+    return occupants[XY_KEY(x, y)] - 1;
+}
+
+void set_map_occupant(int x, int y, int id)
+{
+    Map* m = get_active_map();
+    if (!in_bounds(m, x, y) || XY_KEY(x, y) >= (unsigned) occupant_cells)
+        return;
+    if (id > MAX_OCCUPANT_ID) {
+        pc.printf("BAD OCCUPANT");
+        return;
+    }
+    occupants[XY_KEY(x, y)] = id + 1;
+}
+
+void clear_map_occupants()
+{
+    int n = map_area();
+    if (n > occupant_cells) {
+        free(occupants);
+        occupants = (unsigned char*) malloc(n);
+        occupant_cells = occupants ? n : 0;
+        if (!occupants)
+            pc.printf("OUT OF MEMORY");
+    }
+    if (occupants)
+        memset(occupants, 0, occupant_cells);
 }
 
 void map_erase(int x, int y)
 {
-    MapItem* item = get_here(x, y);
-    if (item && item->data)
-        free(item->data);
-    deleteItem(get_active_map()->items, XY_KEY(x, y));
+    Map* m = get_active_map();
+    if (!in_bounds(m, x, y))
+        return;
+    // An erased perimeter cell is empty, not a border wall
+    override_edge(m, x, y);
+    free_map_item(m, map_remove(m, XY_KEY(x, y)));
+    set_cell_bits(m, x, y, NULL);
+    map_changed(x, y);
 }
 
 void add_wall(int x, int y, int dir, int len)
 {
     for(int i = 0; i < len; i++)
     {
-        MapItem* w1 = (MapItem*) malloc(sizeof(MapItem));
-        if (!w1)
-            pc.printf("OUT OF MEMORY");
-        w1->type = WALL;
-        w1->draw = draw_wall;
-        w1->walkable = false;
-        w1->data = NULL;
-        unsigned key = (dir == HORIZONTAL) ? XY_KEY(x+i, y) : XY_KEY(x, y+i);
-        void* val = insertItem(get_active_map()->items, key, w1);
-        if (val) free(val); // If something was already there, free it
+        MapItem* w1 = prototype(WALL);
+        if (dir == HORIZONTAL) set_here(x+i, y, w1);
+        else set_here(x, y+i, w1);
     }
 }
 
 void add_dot(int x, int y)
 {
-    MapItem* w1 = (MapItem*) malloc(sizeof(MapItem));
-    if (!w1)
-        pc.printf("OUT OF MEMORY");
-    w1->type = DOT;
-    w1->draw = draw_dot;
-    w1->walkable = true;
-    w1->data = NULL;
-    void* val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val) free(val); // If something was already there, free it
+    MapItem* w1 = prototype(DOT);
+    set_here(x, y, w1);
 }
 
 void add_tree(int x, int y)
 {
-    MapItem* w1 = (MapItem*) malloc(sizeof(MapItem));
-    if (!w1)
-        pc.printf("OUT OF MEMORY");
-    w1->type = TREE;
-    w1->draw = draw_tree;
-    w1->walkable = true;
-    w1->data = NULL;
-    void* val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val) free(val); // If something was already there, free it
+    MapItem* w1 = prototype(TREE);
+    set_here(x, y, w1);
 }
 
 void add_portal(int x, int y, int tm, int tx, int ty)
 {
-    MapItem* w1 = (MapItem*) malloc(sizeof(MapItem));
-    if (!w1)
-        pc.printf("OUT OF MEMORY");
+    MapItem* w1 = (MapItem*) new_map_block(get_active_map());
     w1->type = PORTAL;
     w1->draw = draw_portal;
     w1->walkable = false;
-    PortalData* w2 = (PortalData*) malloc(sizeof(PortalData));
-    if (!w2)
-        pc.printf("OUT OF MEMORY");
+    PortalData* w2 = (PortalData*) new_map_block(get_active_map());
     w2->tm = tm;
     w2->tx = tx;
     w2->ty = ty;
     w1->data = w2;
-    void* val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val) free(val); // If something was already there, free it
+    set_here(x, y, w1);
 }
 
 void add_prize(int x, int y)
 {
-    MapItem* w1 = (MapItem*) malloc(sizeof(MapItem));
-    if (!w1)
-        pc.printf("OUT OF MEMORY");
-    w1->type = PRIZE;
-    w1->draw = draw_prize;
-    w1->walkable = true;
-    w1->data = NULL;
-    void* val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val) free(val); // If something was already there, free it
+    MapItem* w1 = prototype(PRIZE);
+    set_here(x, y, w1);
 }
 
 void add_door(int x, int y)
 {
-    MapItem* w1 = (MapItem*) malloc(sizeof(MapItem));
-    if (!w1)
-        pc.printf("OUT OF MEMORY");
-    w1->type = DOOR;
-    w1->draw = draw_door;
-    w1->walkable = false;
-    w1->data = NULL;
-    void* val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val) free(val); // If something was already there, free it
+    MapItem* w1 = prototype(DOOR);
+    set_here(x, y, w1);
 }
@@ -90,6 +90,33 @@ Map* get_map(int m);
  */
 void print_map();
 
+/**
+ * Print the heap usage of both maps to the serial console, comparing the
+ * HashTable store with the grid store so each map can pick the smaller one.
+ */
+void print_map_memory();
+
+/**
+ * Print the load statistics of every map that uses the HashTable store: load
+ * factor, longest chain, mean probes per lookup and a chain length histogram.
+ */
+void print_map_stats();
+
+/**
+ * Benchmark the HASH_CHAINED and HASH_OPEN hash table engines on the keys used
+ * by each map, printing insert/lookup/erase latency and heap bytes to the
+ * serial console. The maps themselves are not modified.
+ */
+void benchmark_map_tables();
+
+/**
+ * Compare get_here against the lookup rule used before perimeter cells were
+ * stored under their own keys, and the bit planes against get_here, for every
+ * cell of both maps and a ring just outside them. Prints a summary per map and
+ * returns the number of mismatches.
+ */
+int check_map_lookups();
+
 // Access
 /**
  * Returns the width of the active map.
@@ -131,6 +158,49 @@ MapItem* get_west(int x, int y);
  */
 MapItem* get_here(int x, int y);
 
+/**
+ * Every map also keeps two bit planes, one bit per cell row by row, kept up
+ * to date by every add_* and map_erase, so the common questions about a cell
+ * are answered with a shift and a mask instead of a lookup:
+ *
+ * - walkable: the player can step there (nothing there, or a walkable item)
+ * - empty: nothing at all there, which is where the ghosts can go
+ *
+ * Cells outside the map read as 1 in both, just as get_here finds nothing
+ * there.
+ */
+int map_walkable(int x, int y);
+int map_empty(int x, int y);
+
+/**
+ * Returns the bits of the n (at most 32) cells from (x, y) to (x+n-1, y),
+ * cell x in bit 0, read a word at a time.
+ */
+unsigned map_walkable_row(int x, int y, int n);
+unsigned map_empty_row(int x, int y, int n);
+
+/**
+ * Returns the bits of the 3x3 cells centred on (x, y), with the cell at
+ * (x+dx, y+dy) in bit AROUND_BIT(dx, dy).
+ */
+unsigned map_walkable_around(int x, int y);
+unsigned map_empty_around(int x, int y);
+#define AROUND_BIT(dx, dy) (1u << (((dy) + 1) * 3 + (dx) + 1))
+
+/**
+ * Which entity (by id, e.g. a ghost's index) stands on each cell of the
+ * active map, so that finding one is a single read instead of a search of
+ * every entity. Entities only exist on the active map, so one layer is shared
+ * by both maps: clear_map_occupants empties it, sized for the active map,
+ * whenever the entities are placed anew. Ids go up to MAX_OCCUPANT_ID, and
+ * cells outside the map hold NO_OCCUPANT.
+ */
+#define NO_OCCUPANT     -1
+#define MAX_OCCUPANT_ID 254
+int map_occupant(int x, int y);
+void set_map_occupant(int x, int y, int id);
+void clear_map_occupants();
+
 // Directions, for using the modification functions
 #define HORIZONTAL  0
 #define VERTICAL    1
@@ -140,6 +210,20 @@ MapItem* get_here(int x, int y);
  */
 void map_erase(int x, int y);
 
+/**
+ * A function called with the position of each cell of the active map whose
+ * contents change (an item is added, replaced or erased), so that anything
+ * derived from the map can be kept up to date without rescanning it.
+ */
+typedef void (*MapListener)(int x, int y);
+
+/**
+ * Call listener on every change to the active map from now on. At most
+ * MAX_MAP_LISTENERS can be added.
+ */
+#define MAX_MAP_LISTENERS 4
+void add_map_listener(MapListener listener);
+
 /**
  * Add WALL items in a line of length len beginning at (x,y).
  * If dir == HORIZONTAL, the line is in the direction of increasing x.
@@ -0,0 +1,166 @@
+#include "globals.h"
+#include "pool.h"
+
+#include <stdlib.h>   // For malloc and free
+
+/**
+ * Blocks are aligned to the size of a pointer (4 bytes on the LPC1768), which
+ * covers every struct stored in them.
+ */
+#define POOL_ALIGN sizeof(void*)
+
+/**
+ * Heap bytes taken by one malloc of the given size. newlib's allocator adds a
+ * 4-byte size header and rounds chunks up to 8 bytes, with a 16-byte minimum.
+ */
+#define MALLOC_CHUNK(size) ((size) + 4 < 16 ? 16 : ((size) + 4 + 7) & ~7u)
+
+/**
+ * A slab of blocks taken from the heap at once. The blocks follow the header.
+ */
+typedef struct _Slab {
+    struct _Slab* next;
+} Slab;
+
+/**
+ * A free block. While a block is free, its first bytes link it into the free
+ * list.
+ */
+typedef struct _FreeBlock {
+    struct _FreeBlock* next;
+} FreeBlock;
+
+struct _Pool {
+    /** Bytes per block, at least sizeof(FreeBlock) and aligned */
+    unsigned int block_size;
+
+    /** Blocks in each slab */
+    unsigned int blocks_per_slab;
+
+    /** All slabs, in the order they were allocated */
+    Slab* slabs;
+
+    /** The slab blocks are currently being carved from, or NULL */
+    Slab* current;
+
+    /** The number of blocks of current not handed out yet */
+    unsigned int untouched;
+
+    /** Blocks that were handed out and then freed */
+    FreeBlock* free_list;
+
+    /** Counters for getPoolStats */
+    unsigned int num_slabs;
+    unsigned int live;
+    unsigned int high_water;
+};
+
+Pool* createPool(unsigned int blockSize, unsigned int blocksPerSlab) {
+    Pool* pool = (Pool*)malloc(sizeof(Pool));
+    if (!pool) {
+        pc.printf("OUT OF MEMORY");
+        return NULL;
+    }
+
+    if (blockSize < sizeof(FreeBlock))
+        blockSize = sizeof(FreeBlock);
+    pool->block_size = (blockSize + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+    pool->blocks_per_slab = blocksPerSlab ? blocksPerSlab : 1;
+    pool->slabs = NULL;
+    pool->current = NULL;
+    pool->untouched = 0;
+    pool->free_list = NULL;
+    pool->num_slabs = 0;
+    pool->live = 0;
+    pool->high_water = 0;
+    return pool;
+}
+
+void destroyPool(Pool* pool) {
+    if (!pool)
+        return;
+    Slab* slab = pool->slabs;
+    Slab* next;
+    while (slab) {
+        next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    free(pool);
+}
+
+/**
+ * nextSlab
+ *
+ * Helper function that makes the slab after current (or a newly allocated
+ * one, if there is none) the slab blocks are carved from.
+ *
+ * @param pool The pointer to the pool.
+ * @return zero if the heap is out of memory
+ */
+static int nextSlab(Pool* pool) {
+    // After a reset, the slabs already allocated are reused first
+    Slab* slab = pool->current ? pool->current->next : pool->slabs;
+    if (!slab) {
+        slab = (Slab*)malloc(sizeof(Slab) + pool->blocks_per_slab * pool->block_size);
+        if (!slab) {
+            pc.printf("OUT OF MEMORY");
+            return 0;
+        }
+        slab->next = NULL;
+        if (pool->current)
+            pool->current->next = slab;
+        else
+            pool->slabs = slab;
+        pool->num_slabs++;
+    }
+    pool->current = slab;
+    pool->untouched = pool->blocks_per_slab;
+    return 1;
+}
+
+void* poolAlloc(Pool* pool) {
+    void* block;
+    if (pool->free_list) {
+        block = pool->free_list;
+        pool->free_list = pool->free_list->next;
+    } else {
+        if (!pool->untouched && !nextSlab(pool))
+            return NULL;
+        // Hand out the untouched blocks of the current slab in order
+        unsigned int index = pool->blocks_per_slab - pool->untouched;
+        block = (char*)(pool->current + 1) + index * pool->block_size;
+        pool->untouched--;
+    }
+
+    pool->live++;
+    if (pool->live > pool->high_water)
+        pool->high_water = pool->live;
+    return block;
+}
+
+void poolFree(Pool* pool, void* block) {
+    if (!block)
+        return;
+    FreeBlock* freeBlock = (FreeBlock*)block;
+    freeBlock->next = pool->free_list;
+    pool->free_list = freeBlock;
+    pool->live--;
+}
+
+void poolReset(Pool* pool) {
+    pool->current = NULL;
+    pool->untouched = 0;
+    pool->free_list = NULL;
+    pool->live = 0;
+}
+
+void getPoolStats(Pool* pool, PoolStats* stats) {
+    stats->block_size = pool->block_size;
+    stats->live = pool->live;
+    stats->high_water = pool->high_water;
+    stats->slab_bytes = pool->num_slabs
+                        * MALLOC_CHUNK(sizeof(Slab) + pool->blocks_per_slab * pool->block_size);
+    stats->bytes_saved = (int)(pool->live * MALLOC_CHUNK(pool->block_size))
+                         - (int)stats->slab_bytes;
+}
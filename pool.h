@@ -0,0 +1,88 @@
+#ifndef POOL_H
+#define POOL_H
+
+/**
+ * A fixed-size block pool. Blocks are carved out of larger slabs taken from
+ * the heap, and freed blocks are kept on a free list, so allocating and
+ * freeing a block are O(1) and the heap never sees the small allocations.
+ *
+ * The implementation is private; use the functions below.
+ */
+typedef struct _Pool Pool;
+
+/**
+ * Usage counters of a pool, filled in by getPoolStats.
+ */
+typedef struct {
+    unsigned int block_size;    // Bytes per block, after alignment
+    unsigned int live;          // Blocks currently allocated
+    unsigned int high_water;    // Most blocks ever allocated at once
+    unsigned int slab_bytes;    // Heap bytes taken by all slabs
+    int bytes_saved;            // Heap bytes saved versus one malloc per live block
+} PoolStats;
+
+/**
+ * createPool
+ *
+ * Create an empty pool of blocks of the given size. No slab is allocated
+ * until the first block is requested.
+ *
+ * @param blockSize The size of each block, in bytes.
+ * @param blocksPerSlab The number of blocks taken from the heap at once.
+ * @return a pointer to the new pool
+ */
+Pool* createPool(unsigned int blockSize, unsigned int blocksPerSlab);
+
+/**
+ * destroyPool
+ *
+ * Free every slab of the pool, and the pool itself. All blocks allocated from
+ * the pool become invalid.
+ *
+ * @param pool The pointer to the pool.
+ */
+void destroyPool(Pool* pool);
+
+/**
+ * poolAlloc
+ *
+ * Allocate one block from the pool, taking a new slab from the heap if every
+ * block is in use. The block is not initialized.
+ *
+ * @param pool The pointer to the pool.
+ * @return a pointer to the block, or NULL if the heap is out of memory
+ */
+void* poolAlloc(Pool* pool);
+
+/**
+ * poolFree
+ *
+ * Return a block to the pool. The block must have come from this pool. NULL
+ * is ignored.
+ *
+ * @param pool The pointer to the pool.
+ * @param block The block to free.
+ */
+void poolFree(Pool* pool, void* block);
+
+/**
+ * poolReset
+ *
+ * Free every block of the pool at once. The slabs are kept for reuse, so
+ * this is the cheap way to throw away everything allocated from an arena.
+ *
+ * @param pool The pointer to the pool.
+ */
+void poolReset(Pool* pool);
+
+/**
+ * getPoolStats
+ *
+ * Read the usage counters of the pool.
+ *
+ * @param pool The pointer to the pool.
+ * @param stats The counters to fill in.
+ */
+void getPoolStats(Pool* pool, PoolStats* stats);
+
+#endif
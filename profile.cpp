@@ -0,0 +1,105 @@
+#include "profile.h"
+
+#if PROFILE_FRAMES
+
+/**
+ * Histogram buckets: under 64 us, then doubling up to under 32 ms, then the
+ * rest.
+ */
+#define PROFILE_BUCKETS 11
+#define PROFILE_FIRST_BUCKET_US 64
+
+static const char* phase_names[PROF_PHASES] = {
+    "read_inputs", "get_action", "update_game", "update_npcs",
+    "  flow field", "draw_game", "  tiles", "  status", "frame", "press latency"
+};
+
+/**
+ * The last PROFILE_FRAMES_KEPT samples of each phase, the oldest overwritten
+ * first, and how many samples each phase has ever kept.
+ */
+static unsigned int samples[PROF_PHASES][PROFILE_FRAMES_KEPT];
+static unsigned int sample_count[PROF_PHASES];
+
+/**
+ * profile_timer time each running phase started at.
+ */
+static int started[PROF_PHASES];
+static bool running[PROF_PHASES];
+
+static Timer profile_timer;
+static bool timer_started;
+static unsigned int frames;
+
+void profile_start(int phase)
+{
+    if (!timer_started) {
+        profile_timer.start();
+        timer_started = true;
+    }
+    started[phase] = profile_timer.read_us();
+    running[phase] = true;
+}
+
+void profile_stop(int phase)
+{
+    if (!running[phase])
+        return;
+    running[phase] = false;
+    profile_sample(phase, profile_timer.read_us() - started[phase]);
+}
+
+void profile_sample(int phase, unsigned int us)
+{
+    samples[phase][sample_count[phase] % PROFILE_FRAMES_KEPT] = us;
+    sample_count[phase]++;
+}
+
+/**
+ * Print min, mean, 99th percentile, max and histogram of every phase.
+ */
+static void profile_report()
+{
+    static unsigned int sorted[PROFILE_FRAMES_KEPT];
+
+    pc.printf("Profile after %u frames, last %d samples of each phase (us):\r\n", frames, PROFILE_FRAMES_KEPT);
+    pc.printf("%-21s %6s %6s %6s %6s |  <64 <128 <256 <512  <1k  <2k  <4k  <8k <16k <32k more\r\n",
+        "", "min", "mean", "p99", "max");
+    for (int p = 0; p < PROF_PHASES; p++) {
+        unsigned int n = sample_count[p] < PROFILE_FRAMES_KEPT ? sample_count[p] : PROFILE_FRAMES_KEPT;
+        if (!n)
+            continue;
+
+        // Insertion sort: the samples are few, and this only runs per report
+        unsigned int sum = 0;
+        unsigned int hist[PROFILE_BUCKETS] = {0};
+        for (unsigned int i = 0; i < n; i++) {
+            unsigned int us = samples[p][i];
+            unsigned int j = i;
+            for (; j > 0 && sorted[j-1] > us; j--)
+                sorted[j] = sorted[j-1];
+            sorted[j] = us;
+            sum += us;
+
+            int b = 0;
+            for (unsigned int edge = PROFILE_FIRST_BUCKET_US; us >= edge && b < PROFILE_BUCKETS - 1; edge *= 2)
+                b++;
+            hist[b]++;
+        }
+
+        pc.printf("%-21s %6u %6u %6u %6u |", phase_names[p],
+            sorted[0], sum / n, sorted[(n * 99 + 99) / 100 - 1], sorted[n-1]);
+        for (int b = 0; b < PROFILE_BUCKETS; b++)
+            pc.printf(" %4u", hist[b]);
+        pc.printf("\r\n");
+    }
+}
+
+void profile_frame_done()
+{
+    frames++;
+    if (frames % PROFILE_FRAMES_KEPT == 0)
+        profile_report();
+}
+
+#endif // PROFILE_FRAMES
@@ -0,0 +1,81 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "globals.h"
+
+/**
+ * A frame-time profiler for the main loop. Each phase of a frame is timed in
+ * microseconds into a ring buffer of the last PROFILE_FRAMES_KEPT samples,
+ * and every PROFILE_FRAMES_KEPT frames the min, mean, 99th percentile, max
+ * and a histogram of each phase are printed to the USB console.
+ *
+ * With PROFILE_FRAMES set to 0 (see globals.h) the macros below expand to
+ * nothing and none of this is compiled in.
+ */
+#define PROFILE_FRAMES_KEPT 128
+
+/**
+ * The timed phases. Phases may nest: PROF_UPDATE covers the PROF_FLOW repairs
+ * of the map changes it makes, PROF_DRAW covers PROF_TILES and PROF_STATUS,
+ * and PROF_FRAME covers the whole frame except its final wait.
+ */
+enum ProfilePhase {
+    PROF_INPUTS,    // read_inputs
+    PROF_ACTION,    // get_action
+    PROF_UPDATE,    // update_game, including any speech it waits on
+    PROF_NPCS,      // update_npcs
+    PROF_FLOW,      // searching or repairing the ghosts' flow field
+    PROF_DRAW,      // draw_game
+    PROF_TILES,     // draw_game: working out and drawing the changed tiles
+    PROF_STATUS,    // draw_game: the status bars
+    PROF_FRAME,     // everything but the frame delay
+    PROF_PRESS,     // from a button press to the read_inputs that takes it
+    PROF_PHASES
+};
+
+#if PROFILE_FRAMES
+
+/**
+ * profile_start
+ *
+ * Start timing a phase.
+ */
+void profile_start(int phase);
+
+/**
+ * profile_stop
+ *
+ * Stop timing a phase and keep the sample. A phase stopped without being
+ * started (e.g. update_npcs on a frame it does not run) keeps no sample.
+ */
+void profile_stop(int phase);
+
+/**
+ * profile_sample
+ *
+ * Keep a sample of a phase timed some other way, in microseconds.
+ */
+void profile_sample(int phase, unsigned int us);
+
+/**
+ * profile_frame_done
+ *
+ * Count a frame, and print the report every PROFILE_FRAMES_KEPT frames.
+ */
+void profile_frame_done();
+
+#define PROFILE_START(phase) profile_start(phase)
+#define PROFILE_STOP(phase)  profile_stop(phase)
+#define PROFILE_SAMPLE(phase, us) profile_sample(phase, us)
+#define PROFILE_FRAME_DONE() profile_frame_done()
+
+#else
+
+#define PROFILE_START(phase) do {} while (0)
+#define PROFILE_STOP(phase)  do {} while (0)
+#define PROFILE_SAMPLE(phase, us) do {} while (0)
+#define PROFILE_FRAME_DONE() do {} while (0)
+
+#endif // PROFILE_FRAMES
+
+#endif // PROFILE_H
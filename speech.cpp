@@ -51,8 +51,8 @@ void speech_bubble_wait()
 {
     GameInputs inputs;
     do {
+        wait_for_press();
         inputs = read_inputs();
-        wait_ms(20);
     } while (!inputs.b4);
 }
 